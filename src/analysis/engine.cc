@@ -0,0 +1,247 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <ranges>
+#include <stop_token>
+#include <string>
+#include <vector>
+module logic.analysis;
+import logic.core;
+import logic.data;
+import logic.util;
+
+namespace logic {
+
+AnalysisEngine::AnalysisEngine (IBackend *backend, size_t threadsNo) : backend{backend}, pool{threadsNo}
+{
+        backend->addObserver (this);
+        dispatcher = std::jthread{[this] (std::stop_token const &stop) { loop (stop); }};
+}
+
+/****************************************************************************/
+
+AnalysisEngine::~AnalysisEngine ()
+{
+        backend->removeObserver (this);
+        dispatcher.request_stop ();
+        wakeCVar.notify_all ();
+
+        if (dispatcher.joinable ()) {
+                dispatcher.join ();
+        }
+}
+
+/****************************************************************************/
+
+void AnalysisEngine::add (IAnalyzer *analyzer, size_t groupIdx)
+{
+        std::lock_guard passLock{passMutex};
+        std::lock_guard lock{entriesMutex};
+
+        if (find (analyzer) != nullptr) {
+                throw Exception{"AnalysisEngine::add : the analyzer is already registered."};
+        }
+
+        analyzer->start ();
+        entries.push_back ({.analyzer = analyzer, .groupIdx = groupIdx});
+        wake (); // Catch up with what's already in the backend.
+}
+
+/****************************************************************************/
+
+void AnalysisEngine::remove (IAnalyzer *analyzer)
+{
+        std::lock_guard passLock{passMutex};
+        std::lock_guard lock{entriesMutex};
+
+        if (auto i = std::ranges::find (entries, analyzer, &Entry::analyzer); i != entries.end ()) {
+                entries.erase (i);
+                analyzer->stop ();
+        }
+}
+
+/****************************************************************************/
+
+void AnalysisEngine::restart (IAnalyzer *analyzer)
+{
+        std::lock_guard passLock{passMutex};
+        std::lock_guard lock{entriesMutex};
+        auto *e = find (analyzer);
+
+        if (e == nullptr) {
+                throw Exception{"AnalysisEngine::restart : unknown analyzer."};
+        }
+
+        *e = {.analyzer = analyzer, .groupIdx = e->groupIdx};
+        analyzer->start ();
+        wake ();
+}
+
+/****************************************************************************/
+
+AnalysisProgress AnalysisEngine::progress (IAnalyzer const *analyzer) const
+{
+        std::lock_guard lock{entriesMutex};
+        auto i = std::ranges::find (entries, analyzer, &Entry::analyzer);
+
+        if (i == entries.end ()) {
+                throw Exception{"AnalysisEngine::progress : unknown analyzer."};
+        }
+
+        auto sr = backend->sampleRate (i->groupIdx);
+        return {.processed = SampleIdx{i->processed, sr}, .checkpoint = SampleIdx{i->checkpoint, sr}, .failed = i->failed, .error = i->error};
+}
+
+/****************************************************************************/
+
+void AnalysisEngine::sync ()
+{
+        while (pass ()) {
+        }
+}
+
+/****************************************************************************/
+
+void AnalysisEngine::onNewData (DataChange const &change)
+{
+        if (change.cleared) {
+                std::lock_guard lock{entriesMutex};
+
+                if (cleared.size () <= change.groupIdx) {
+                        cleared.resize (change.groupIdx + 1);
+                }
+
+                cleared.at (change.groupIdx) = true;
+        }
+
+        wake ();
+}
+
+/****************************************************************************/
+
+void AnalysisEngine::wake ()
+{
+        {
+                std::lock_guard lock{wakeMutex};
+                newData = true;
+        }
+
+        wakeCVar.notify_one ();
+}
+
+/****************************************************************************/
+
+bool AnalysisEngine::pass ()
+{
+        ZoneScoped;
+        std::lock_guard passLock{passMutex};
+        std::vector<Entry *> jobs;
+
+        {
+                std::lock_guard lock{entriesMutex};
+                lastLength.resize (backend->groupsNumber ());
+
+                for (size_t g = 0; g < cleared.size (); ++g) {
+                        if (!cleared.at (g)) {
+                                continue;
+                        }
+
+                        for (auto &e : entries | std::views::filter ([g] (auto const &x) { return x.groupIdx == g; })) {
+                                e = {.analyzer = e.analyzer, .groupIdx = g};
+                                e.analyzer->start ();
+                        }
+
+                        cleared.at (g) = false;
+                }
+
+                for (size_t g = 0; g < lastLength.size (); ++g) {
+                        lastLength.at (g) = backend->channelLength (g).get ();
+                }
+
+                for (auto &e : entries) {
+                        if (!e.failed && e.groupIdx < lastLength.size () && e.processed < lastLength.at (e.groupIdx)) {
+                                jobs.push_back (&e);
+                        }
+                }
+        }
+
+        // Entries are modified only here (we hold the passMutex), so the pointers stay valid.
+        pool.parallelFor (jobs.size (), [this, &jobs] (size_t i) {
+                auto *e = jobs.at (i);
+                step (e, lastLength.at (e->groupIdx), backend->sampleRate (e->groupIdx));
+        });
+
+        return !jobs.empty ();
+}
+
+/****************************************************************************/
+
+void AnalysisEngine::step (Entry *e, int64_t length, SampleRate sampleRate)
+{
+        ZoneScoped;
+        auto const begin = e->processed;
+        auto const end = std::min (length, begin + maxChunk.load ());
+        auto const from = std::min (e->checkpoint, begin);
+
+        try {
+                auto range = backend->range (e->groupIdx, SampleIdx{from, sampleRate}, SampleNum{end - from, sampleRate});
+                auto checkpoint = e->analyzer->feed (range, SampleIdx{begin, sampleRate}, SampleNum{end - begin, sampleRate});
+
+                std::lock_guard lock{entriesMutex};
+                e->processed = end;
+                e->checkpoint = std::clamp (checkpoint.get (), from, end);
+        }
+        catch (std::exception const &ex) {
+                std::lock_guard lock{entriesMutex};
+                e->processed = end;
+                e->failed = true;
+                e->error = ex.what ();
+        }
+}
+
+/****************************************************************************/
+
+AnalysisEngine::Entry *AnalysisEngine::find (IAnalyzer const *analyzer)
+{
+        auto i = std::ranges::find (entries, analyzer, &Entry::analyzer);
+        return (i == entries.end ()) ? (nullptr) : (&*i);
+}
+
+/****************************************************************************/
+
+void AnalysisEngine::loop (std::stop_token const &stop)
+{
+        setThreadName ("analysis");
+
+        while (!stop.stop_requested ()) {
+                {
+                        std::unique_lock lock{wakeMutex};
+
+                        if (!wakeCVar.wait (lock, stop, [this] { return newData; })) {
+                                break;
+                        }
+
+                        newData = false;
+                }
+
+                try {
+                        while (!stop.stop_requested () && pass ()) {
+                        }
+                }
+                catch (std::exception const &) {
+                        // Backend errors (analyzer ones are caught in step). Try again with the next notification.
+                }
+        }
+}
+
+} // namespace logic
@@ -0,0 +1,275 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <vector>
+module logic.analysis;
+import logic.core;
+import logic.data;
+import logic.util;
+
+namespace logic {
+
+namespace {
+        constexpr size_t WORD_BITS = ConditionEvaluator::WORD_BITS;
+
+        /// The level if all the samples are the same.
+        std::optional<bool> constant (Block const &block, size_t c)
+        {
+                if (!block.stats ().empty ()) {
+                        auto const &s = block.stats ().at (c);
+                        return (s.edges == 0) ? (std::optional{s.first}) : (std::nullopt);
+                }
+
+                auto const &channel = block.channel (c);
+
+                if (channel.empty () || (channel.front () != 0x00 && channel.front () != 0xff)) {
+                        return {};
+                }
+
+                if (!std::ranges::all_of (channel, [f = channel.front ()] (uint8_t b) { return b == f; })) {
+                        return {};
+                }
+
+                return channel.front () != 0;
+        }
+
+        /// Results of a couple of consecutive blocks.
+        struct Chunk {
+                std::vector<int64_t> hits;
+                std::optional<int64_t> firstEdge; // pulseWidth : a pulse ending here began in one of the previous chunks.
+                bool firstEdgeEnds{};             // ... if the edge is leaving the `level`.
+                std::optional<int64_t> lastEdge;
+                bool done{};
+        };
+
+        class BlockScanner {
+        public:
+                BlockScanner (SearchCondition const &cond, int64_t lo, int64_t hi, size_t limit) : cond{cond}, lo{lo}, hi{hi}, limit{limit} {}
+                void scan (Block const &block, Block const *previous, Chunk *chunk);
+
+        private:
+                bool skip (Block const &block, ConditionEvaluator const &eval) const;
+
+                SearchCondition const &cond;
+                int64_t lo;
+                int64_t hi;
+                size_t limit;
+                std::optional<int64_t> runStart; // pulseWidth
+        };
+
+        /****************************************************************************/
+
+        bool BlockScanner::skip (Block const &block, ConditionEvaluator const &eval) const
+        {
+                using Type = SearchCondition::Type;
+
+                // No transitions in the block (including the one from the previous block).
+                auto steady = [&] (size_t c) {
+                        auto l = constant (block, c);
+                        return l && *l == eval.previous (c, 0);
+                };
+
+                // None of the samples is at the expected level.
+                auto never = [&] (size_t c) {
+                        auto l = constant (block, c);
+                        return l && *l != bool ((cond.value >> c) & 1);
+                };
+
+                auto masked = std::views::iota (0UZ, block.channelsNumber ()) | std::views::filter ([this] (size_t c) { return (cond.mask >> c) & 1; });
+
+                if (cond.type == Type::pattern) {
+                        return std::ranges::any_of (masked, never) || std::ranges::all_of (masked, steady);
+                }
+
+                if (cond.type == Type::edge) {
+                        return steady (cond.channel) || std::ranges::any_of (masked, never);
+                }
+
+                return steady (cond.channel);
+        }
+
+        /****************************************************************************/
+
+        void BlockScanner::scan (Block const &block, Block const *previous, Chunk *chunk)
+        {
+                using Type = SearchCondition::Type;
+
+                auto const first = block.firstSampleNo ().get ();
+                auto const n = block.channelBytes () * CHAR_BIT;
+
+                // Transitions between p - 1 and p, both in [lo, hi].
+                auto const from = size_t (std::clamp<int64_t> (lo + 1 - first, 0, int64_t (n)));
+                auto const to = size_t (std::clamp<int64_t> (hi + 1 - first, 0, int64_t (n)));
+
+                if (from >= to) {
+                        return;
+                }
+
+                std::optional<uint64_t> previousLevels;
+
+                if (previous != nullptr) {
+                        ConditionEvaluator const p{previous->data ()};
+                        previousLevels = 0;
+
+                        for (size_t c = 0; c < p.channelsNumber (); ++c) {
+                                *previousLevels |= uint64_t (p.previous (c, p.size ())) << c;
+                        }
+                }
+
+                ConditionEvaluator const eval{block.data (), previousLevels};
+
+                if (skip (block, eval)) {
+                        return;
+                }
+
+                for (auto w = from / WORD_BITS; w * WORD_BITS < to; ++w) {
+                        auto const valid = ConditionEvaluator::valid (w, from, to);
+
+                        if (cond.type != Type::pulseWidth) {
+                                for (auto hits = eval.hits (cond, w) & valid; hits != 0 && chunk->hits.size () < limit;) {
+                                        chunk->hits.push_back (first + int64_t ((w * WORD_BITS) + ConditionEvaluator::pop (&hits)));
+                                }
+
+                                continue;
+                        }
+
+                        uint64_t samples{};
+
+                        for (auto changes = eval.edges (cond.channel, w, &samples) & valid; changes != 0;) {
+                                auto p = ConditionEvaluator::pop (&changes);
+                                auto abs = first + int64_t ((w * WORD_BITS) + p);
+                                bool ends = ConditionEvaluator::ends (cond, samples, p);
+
+                                if (!chunk->firstEdge) {
+                                        chunk->firstEdge = abs;
+                                        chunk->firstEdgeEnds = ends;
+                                }
+                                else if (ends && cond.widthMatches (uint64_t (abs - *runStart))) {
+                                        chunk->hits.push_back (abs);
+                                }
+
+                                runStart = abs;
+                                chunk->lastEdge = abs;
+                        }
+                }
+        }
+
+} // namespace
+
+/****************************************************************************/
+
+Searcher::Searcher (IBackend const *backend, size_t threadsNo) : backend{backend}, pool{threadsNo} {}
+
+/****************************************************************************/
+
+std::vector<SampleIdx> Searcher::search (size_t group, SearchCondition const &condition, SampleIdx begin, SampleIdx end, size_t limit)
+{
+        ZoneScoped;
+        using Type = SearchCondition::Type;
+        cancelled_ = false;
+        std::vector<SampleIdx> results;
+        auto const channelsNo = backend->channelsNumber (group);
+
+        if (channelsNo > WORD_BITS) {
+                throw Exception{"Searcher::search : too many channels."};
+        }
+
+        if ((condition.type != Type::pattern && condition.channel >= channelsNo) || (channelsNo < WORD_BITS && (condition.mask >> channelsNo) != 0)) {
+                throw Exception{"Searcher::search : no such channel."};
+        }
+
+        if ((condition.type == Type::pattern && condition.mask == 0) || condition.minWidth > condition.maxWidth) {
+                throw Exception{"Searcher::search : invalid condition."};
+        }
+
+        auto const range = backend->range (group, begin, end);
+
+        if (std::ranges::empty (range) || limit == 0) {
+                return results;
+        }
+
+        std::vector<Block const *> blocks;
+
+        for (Block const &b : range) {
+                blocks.push_back (&b);
+        }
+
+        if (blocks.front ()->zoomOut () != 1) {
+                throw Exception{"Searcher::search : zoomed out data."};
+        }
+
+        // A couple of chunks per thread, so the uneven ones (pruned vs. dense) even out.
+        auto const chunkBlocks = std::max<size_t> (blocks.size () / (pool.size () * 4), 1);
+        auto const chunksNo = (blocks.size () + chunkBlocks - 1) / chunkBlocks;
+        std::vector<Chunk> chunks (chunksNo);
+        std::atomic<size_t> cutoff = SIZE_MAX; // Chunks after this one aren't needed to reach the limit.
+        std::mutex cutoffMutex;
+
+        pool.parallelFor (chunksNo, [&] (size_t i) {
+                auto &chunk = chunks[i];
+                BlockScanner scanner{condition, begin.get (), end.get (), limit};
+
+                for (auto b = i * chunkBlocks; b < std::min (blocks.size (), (i + 1) * chunkBlocks); ++b) {
+                        if (cancelled_ || i > cutoff) {
+                                return;
+                        }
+
+                        scanner.scan (*blocks[b], (b > 0) ? (blocks[b - 1]) : (nullptr), &chunk);
+                }
+
+                std::lock_guard lock{cutoffMutex};
+                chunk.done = true;
+                size_t found{};
+
+                for (size_t k = 0; k < chunks.size () && chunks[k].done; ++k) {
+                        if (found += chunks[k].hits.size (); found >= limit) {
+                                cutoff = std::min<size_t> (cutoff, k);
+                                break;
+                        }
+                }
+        });
+
+        // Only the continuous run of the finished chunks.
+        std::optional<int64_t> lastEdge;
+
+        for (size_t i = 0; i < chunks.size () && chunks[i].done && results.size () < limit; ++i) {
+                auto const &chunk = chunks[i];
+
+                // A pulse that started in one of the previous chunks.
+                if (chunk.firstEdge && chunk.firstEdgeEnds && lastEdge) {
+                        if (condition.widthMatches (uint64_t (*chunk.firstEdge - *lastEdge))) {
+                                results.emplace_back (*chunk.firstEdge, begin.sampleRate ());
+                        }
+                }
+
+                if (chunk.lastEdge) {
+                        lastEdge = chunk.lastEdge;
+                }
+
+                for (auto h : chunk.hits) {
+                        results.emplace_back (h, begin.sampleRate ());
+                }
+        }
+
+        if (results.size () > limit) {
+                results.resize (limit);
+        }
+
+        return results;
+}
+
+} // namespace logic
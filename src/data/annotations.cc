@@ -0,0 +1,220 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <vector>
+module logic.data;
+import logic.core;
+
+namespace logic {
+
+void AnnotationStore::add (uint32_t channel, int64_t begin, int64_t end, AnnotationKind kind, std::span<uint8_t const> payload)
+{
+        std::lock_guard lock{mutex};
+
+        if (channel >= tracks.size ()) {
+                tracks.resize (channel + 1);
+        }
+
+        tracks.at (channel).add (begin, end, kind, payload);
+}
+
+/****************************************************************************/
+
+void AnnotationStore::query (int64_t begin, int64_t end, int64_t zoom, std::vector<Annotation> *out) const
+{
+        ZoneScoped;
+        out->clear ();
+        std::lock_guard lock{mutex};
+
+        for (size_t c = 0; c < tracks.size (); ++c) {
+                tracks.at (c).query (uint32_t (c), begin, end, zoom, out);
+        }
+}
+
+/****************************************************************************/
+
+std::vector<uint8_t> AnnotationStore::payload (uint32_t channel, size_t index) const
+{
+        std::lock_guard lock{mutex};
+        auto const &t = tracks.at (channel);
+        auto first = t.payloadOffsets.at (index);
+        auto last = (index + 1 < t.payloadOffsets.size ()) ? (t.payloadOffsets.at (index + 1)) : (t.payloads.size ());
+        return {t.payloads.begin () + ptrdiff_t (first), t.payloads.begin () + ptrdiff_t (last)};
+}
+
+/****************************************************************************/
+
+size_t AnnotationStore::size () const
+{
+        std::lock_guard lock{mutex};
+        size_t n{};
+
+        for (auto const &t : tracks) {
+                n += t.begins.size ();
+        }
+
+        return n;
+}
+
+/****************************************************************************/
+
+size_t AnnotationStore::size (uint32_t channel) const
+{
+        std::lock_guard lock{mutex};
+        return (channel < tracks.size ()) ? (tracks.at (channel).begins.size ()) : (0);
+}
+
+/****************************************************************************/
+
+void AnnotationStore::clear ()
+{
+        std::lock_guard lock{mutex};
+        tracks.clear ();
+}
+
+/****************************************************************************/
+
+void AnnotationStore::Track::add (int64_t begin, int64_t end, AnnotationKind kind, std::span<uint8_t const> payload)
+{
+        if (end < begin) {
+                throw Exception{"AnnotationStore::add : end < begin."};
+        }
+
+        if (!begins.empty () && begin < begins.back ()) {
+                throw Exception{"AnnotationStore::add : annotations on a channel have to be added in order."};
+        }
+
+        auto const i = begins.size ();
+        auto const e = std::max (end, begin + 1); // Point-like markers still occupy their sample.
+
+        begins.push_back (begin);
+        ends.push_back (end);
+        auto &lc = byLength.at (std::bit_width (uint64_t (e - begin)) - 1);
+        lc.indices.push_back (i);
+        lc.maxLength = std::max (lc.maxLength, e - begin);
+        kinds.push_back (kind);
+        payloadOffsets.push_back (payloads.size ());
+        payloads.insert (payloads.end (), payload.begin (), payload.end ());
+
+        // A level is needed as long as the one below has more than one group.
+        for (size_t l = 0; l == 0 || levels.at (l - 1).size () > 1; ++l) {
+                if (l == 0 && levels.empty ()) {
+                        levels.push_back ({{begin, e, kind}});
+                }
+                else if (l == levels.size ()) {
+                        // Covers everything so far, i.e. the 2 groups of the level below.
+                        auto const &below = levels.at (l - 1);
+                        auto worse = (severity (below.back ().kind) > severity (below.front ().kind)) ? (below.back ().kind) : (below.front ().kind);
+                        levels.push_back ({{below.front ().begin, std::max (below.front ().end, below.back ().end), worse}});
+                }
+
+                auto &level = levels.at (l);
+                auto g = i >> (FANOUT_BITS * (l + 1));
+
+                if (g == level.size ()) {
+                        level.push_back ({begin, e, kind});
+                }
+                else {
+                        auto &s = level.at (g);
+                        s.end = std::max (s.end, e);
+                        s.kind = (severity (kind) > severity (s.kind)) ? (kind) : (s.kind);
+                }
+        }
+}
+
+/****************************************************************************/
+
+void AnnotationStore::Track::query (uint32_t channel, int64_t qBegin, int64_t qEnd, int64_t zoom, std::vector<Annotation> *out) const
+{
+        // [mid, hi) begin within the query. Ones before `mid` overlap only if they are long enough.
+        auto mid = size_t (std::ranges::lower_bound (begins, qBegin) - begins.begin ());
+        auto hi = size_t (std::ranges::lower_bound (begins, qEnd) - begins.begin ());
+        auto lastOut = std::numeric_limits<size_t>::max ();
+        bool lastSmall = false;
+
+        auto emit = [&] (Annotation const &a, bool small) {
+                if (small && lastSmall && a.begin - out->at (lastOut).end < zoom) {
+                        auto &last = out->at (lastOut);
+                        last.end = std::max (last.end, a.end);
+                        last.count += a.count;
+                        last.kind = (severity (a.kind) > severity (last.kind)) ? (a.kind) : (last.kind);
+                        return;
+                }
+
+                out->push_back (a);
+                lastOut = out->size () - 1;
+                lastSmall = small;
+        };
+
+        /*
+         * The ones crossing qBegin. Within a length class only those beginning at most maxLength
+         * samples before qBegin can reach it, and all of them are longer than maxLength / 2. So a
+         * single long annotation doesn't make us scan everything after it.
+         */
+        std::vector<size_t> crossing;
+
+        for (auto const &lc : byLength) {
+                auto begin = [this] (size_t j) { return begins.at (j); };
+
+                for (auto j = std::ranges::lower_bound (lc.indices, qBegin - lc.maxLength, {}, begin); j != lc.indices.end () && *j < mid; ++j) {
+                        if (std::max (ends.at (*j), begins.at (*j) + 1) > qBegin) {
+                                crossing.push_back (*j);
+                        }
+                }
+        }
+
+        std::ranges::sort (crossing);
+
+        for (auto i : crossing) {
+                auto b = begins.at (i);
+                auto e = ends.at (i);
+                emit ({.begin = b, .end = e, .channel = channel, .kind = kinds.at (i), .index = i}, zoom > 1 && e - b < zoom);
+        }
+
+        for (auto i = mid; i < hi;) {
+                if (zoom > 1) {
+                        // The biggest group starting at `i`, fully visible and narrower than a pixel is taken at once.
+                        bool skipped = false;
+
+                        for (auto l = levels.size (); l-- > 0;) {
+                                auto bits = FANOUT_BITS * (l + 1);
+                                auto n = size_t (1) << bits;
+
+                                if (i % n != 0 || i + n > hi) {
+                                        continue;
+                                }
+
+                                if (auto const &s = levels.at (l).at (i >> bits); s.end - s.begin < zoom) {
+                                        emit ({.begin = s.begin, .end = s.end, .channel = channel, .kind = s.kind, .count = n, .index = i}, true);
+                                        i += n;
+                                        skipped = true;
+                                        break;
+                                }
+                        }
+
+                        if (skipped) {
+                                continue;
+                        }
+                }
+
+                auto b = begins.at (i);
+                auto e = ends.at (i);
+                emit ({.begin = b, .end = e, .channel = channel, .kind = kinds.at (i), .index = i}, zoom > 1 && e - b < zoom);
+                ++i;
+        }
+}
+
+} // namespace logic
@@ -10,9 +10,13 @@ module;
 #include "common/constants.hh"
 #include <Tracy.hpp>
 #include <algorithm>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <ranges>
+#include <stop_token>
+#include <thread>
+#include <utility>
 #include <vector>
 module logic.data;
 import logic.core;
@@ -20,32 +24,83 @@ import logic.processing;
 
 namespace logic {
 
+namespace {
+
+        /// `b` happened after `a`.
+        DataChange merge (DataChange const &a, DataChange const &b)
+        {
+                if (b.cleared || a.empty ()) {
+                        return {.groupIdx = b.groupIdx,
+                                .first = b.first,
+                                .last = b.last,
+                                .levels = std::max (a.levels, b.levels),
+                                .cleared = a.cleared || b.cleared};
+                }
+
+                if (b.empty ()) {
+                        return a;
+                }
+
+                return {.groupIdx = a.groupIdx,
+                        .first = SampleIdx{std::min (a.first.get (), b.first.get ()), a.first.sampleRate ()},
+                        .last = SampleIdx{std::max (a.last.get (), b.last.get ()), a.last.sampleRate ()},
+                        .levels = std::max (a.levels, b.levels),
+                        .cleared = a.cleared};
+        }
+
+} // namespace
+
+/*--------------------------------------------------------------------------*/
+
 void Backend::append (size_t groupIdx, std::vector<Bytes> &&s)
 {
         ZoneScopedN ("BackendAppend");
+        bool wakeNotifier{};
 
         {
                 std::lock_guard lock{mutex};
-                groups_.at (groupIdx).append (std::move (s));
+                auto &g = groups_.at (groupIdx);
+                auto const before = g.channelLength ().get ();
+                g.append (std::move (s));
+                auto const after = g.channelLength ().get ();
+
+                // Samples become visible only when the pending block is flushed. Queued under the lock, so a `clear` can't get in between.
+                if (after > before) {
+                        wakeNotifier = notifyObservers ({.groupIdx = groupIdx,
+                                          .first = SampleIdx{before, g.sampleRate ()},
+                                          .last = SampleIdx{after - 1, g.sampleRate ()},
+                                          .levels = g.levelsNumber (),
+                                          .cleared = false});
+                }
         }
 
         cvVar.notify_all ();
-        notifyObservers ();
+
+        if (wakeNotifier) {
+                pendingCVar.notify_one ();
+        }
 }
 
 /*--------------------------------------------------------------------------*/
 
 void Backend::clear ()
 {
+        bool wakeNotifier{};
+
         {
                 std::lock_guard lock{mutex};
 
-                for (auto &g : groups_) {
+                for (size_t i = 0; i < groups_.size (); ++i) {
+                        auto &g = groups_.at (i);
                         g.clear ();
+                        auto sr = g.sampleRate ();
+                        wakeNotifier |= notifyObservers ({.groupIdx = i, .first = SampleIdx{0, sr}, .last = SampleIdx{-1, sr}, .levels = 0, .cleared = true});
                 }
         }
 
-        notifyObservers ();
+        if (wakeNotifier) {
+                pendingCVar.notify_one ();
+        }
 }
 
 /*--------------------------------------------------------------------------*/
@@ -77,6 +132,16 @@ Backend::SubRange Backend::range (size_t groupIdx, SampleIdx begin, SampleNum le
 
 /*--------------------------------------------------------------------------*/
 
+ChannelStats Backend::stats (size_t groupIdx, size_t channel, SampleIdx begin, SampleIdx end) const
+{
+        ZoneScopedN ("BackendStats");
+        std::lock_guard lock{mutex};
+        auto mysr = sampleRate (groupIdx);
+        return groups_.at (groupIdx).stats (channel, resample (begin, mysr), resample (end, mysr));
+}
+
+/*--------------------------------------------------------------------------*/
+
 size_t Backend::addGroup (Group const &config)
 {
         std::lock_guard lock{mutex};
@@ -120,10 +185,105 @@ SampleNum Backend::waitLength (size_t groupIdx, SampleNum const &len) const
 
 /*--------------------------------------------------------------------------*/
 
-void Backend::notifyObservers ()
+void Backend::addObserver (IBackendObserver *observer)
+{
+        std::lock_guard lock{observersMutex};
+        observers.insert (observer);
+
+        if (!notifier.joinable ()) {
+                notifier = std::jthread{[this] (std::stop_token const &stop) { notifyLoop (stop); }};
+        }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void Backend::removeObserver (IBackendObserver *observer)
 {
-        for (auto *o : observers) {
-                o->onNewData ();
+        std::lock_guard lock{observersMutex}; // Waits for the delivery in progress.
+        observers.erase (observer);
+}
+
+/*--------------------------------------------------------------------------*/
+
+void Backend::setNotificationRate (double perSecond)
+{
+        {
+                std::lock_guard lock{pendingMutex};
+                notificationInterval = (perSecond > 0)
+                        ? (std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::chrono::duration<double>{1.0 / perSecond}))
+                        : (std::chrono::steady_clock::duration::zero ());
+        }
+
+        intervalCVar.notify_all ();
+}
+
+/*--------------------------------------------------------------------------*/
+
+void Backend::flushNotifications () { deliver (); }
+
+/*--------------------------------------------------------------------------*/
+
+bool Backend::notifyObservers (DataChange const &change)
+{
+        std::lock_guard lock{pendingMutex};
+
+        if (pending.size () <= change.groupIdx) {
+                pending.resize (change.groupIdx + 1);
+        }
+
+        auto &p = pending.at (change.groupIdx);
+        p = (p) ? (merge (*p, change)) : (change);
+        return !std::exchange (anyPending, true);
+}
+
+/*--------------------------------------------------------------------------*/
+
+void Backend::deliver ()
+{
+        ZoneScoped;
+        // Taken first, so the changes are delivered in order even if two threads get here.
+        std::lock_guard observersLock{observersMutex};
+        std::vector<DataChange> changes;
+
+        {
+                std::lock_guard lock{pendingMutex};
+
+                for (auto &p : pending) {
+                        if (p) {
+                                changes.push_back (*p);
+                                p.reset ();
+                        }
+                }
+
+                anyPending = false;
+        }
+
+        for (auto const &change : changes) {
+                for (auto *o : observers) {
+                        o->onNewData (change);
+                }
+        }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void Backend::notifyLoop (std::stop_token const &stop)
+{
+        while (!stop.stop_requested ()) {
+                {
+                        std::unique_lock lock{pendingMutex};
+
+                        if (!pendingCVar.wait (lock, stop, [this] { return anyPending; })) {
+                                return;
+                        }
+                }
+
+                deliver ();
+
+                // Whatever gets appended meanwhile is merged into one notification. Appends don't wake us up here.
+                std::unique_lock lock{pendingMutex};
+                auto const interval = notificationInterval;
+                intervalCVar.wait_until (lock, stop, std::chrono::steady_clock::now () + interval, [this, interval] { return notificationInterval != interval; });
         }
 }
 
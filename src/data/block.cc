@@ -7,10 +7,13 @@
  ****************************************************************************/
 
 module;
+#include <Tracy.hpp>
 #include <algorithm>
+#include <bit>
 #include <climits>
 #include <format>
 #include <ranges>
+#include <span>
 #include <vector>
 module logic.data;
 import logic.core;
@@ -18,16 +21,108 @@ import logic.processing;
 
 namespace logic {
 
+ChannelStats operator+ (ChannelStats const &a, ChannelStats const &b)
+{
+        if (a.samples == 0) {
+                return b;
+        }
+
+        if (b.samples == 0) {
+                return a;
+        }
+
+        return {.samples = a.samples + b.samples,
+                .high = a.high + b.high,
+                .edges = a.edges + b.edges + uint64_t (a.last != b.first),
+                .first = a.first,
+                .last = b.last};
+}
+
+/****************************************************************************/
+
+ChannelStats channelStats (std::span<uint8_t const> channel, size_t from, size_t to)
+{
+        ChannelStats s;
+
+        if (from >= to) {
+                return s;
+        }
+
+        using Span = BitSpan<uint8_t const>;
+        static constexpr auto WORD_BITS = Span::WORD_BITS;
+        Span const span{channel.data (), from, to - from};
+        auto const n = span.size ();
+
+        s.samples = n;
+        s.first = (span.word (0) >> (WORD_BITS - 1)) != 0;
+        s.last = (span.word (n - 1) >> (WORD_BITS - 1)) != 0;
+        uint64_t prev = s.first; // The sample before the word.
+
+        // Edges are where a sample differs from the previous one. Words are zero padded, hence the mask.
+        for (size_t pos = 0; pos < n; pos += WORD_BITS) {
+                auto w = span.word (pos);
+                s.high += std::popcount (w);
+                s.edges += std::popcount ((w ^ ((w >> 1) | (prev << (WORD_BITS - 1)))) & Span::leading (n - pos));
+                prev = w & 1;
+        }
+
+        return s;
+}
+
+/****************************************************************************/
+
+std::vector<ChannelStats> Block::computeStats (Container const &d) const
+{
+        ZoneScoped;
+
+        if (bitsPerSample_ != 1) {
+                return {};
+        }
+
+        return d | std::views::transform ([] (Bytes const &ch) { return channelStats (ch, 0, ch.size () * CHAR_BIT); }) | std::ranges::to<std::vector> ();
+}
+
+/****************************************************************************/
+
+void Block::appendStats (std::vector<ChannelStats> const &s)
+{
+        if (bitsPerSample_ != 1) {
+                stats_.clear ();
+                return;
+        }
+
+        if (stats_.empty ()) {
+                stats_ = s;
+                return;
+        }
+
+        for (auto &&[a, b] : std::views::zip (stats_, s)) {
+                a = a + b;
+        }
+}
+
+/****************************************************************************/
+
 void Block::append (Block &&d)
 {
         bitsPerSample_ = d.bitsPerSample_;
         sampleRate_ = d.sampleRate_;
-        append (std::move (d).data_);
+        appendData (std::move (d).data_);
+        appendStats (d.stats_); // Already computed by the d's constructor.
 }
 
 /****************************************************************************/
 
 void Block::append (Container &&d)
+{
+        auto s = computeStats (d);
+        appendData (std::move (d));
+        appendStats (s);
+}
+
+/****************************************************************************/
+
+void Block::appendData (Container &&d)
 {
         if (channelsNumber () == 0) { // This lets us append to an empty block
                 data_.resize (d.size ());
@@ -88,6 +183,8 @@ void Block::clear ()
         for (auto &ch : data_) {
                 ch.clear ();
         }
+
+        stats_.clear ();
 }
 
 } // namespace logic
\ No newline at end of file
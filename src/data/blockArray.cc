@@ -154,6 +154,35 @@ BlockArray::SubRange BlockArray::range (SampleIdx begin, SampleIdx end, size_t z
 
 /****************************************************************************/
 
+ChannelStats BlockArray::stats (size_t channel, SampleIdx begin, SampleIdx end) const
+{
+        ZoneScoped;
+
+        if (bitsPerSample_ != 1) {
+                throw Exception{"BlockArray::stats : only 1 bit samples are supported."};
+        }
+
+        ChannelStats ret;
+
+        for (Block const &block : range (begin, SampleIdx{end.get () + 1, sampleRate_})) {
+                auto const first = block.firstSampleNo ().get ();
+                auto const n = block.channelLength ().get ();
+                auto const from = std::clamp<int64_t> (begin.get () - first, 0, n);
+                auto const to = std::clamp<int64_t> (end.get () + 1 - first, 0, n);
+
+                if (from == 0 && to == n && !block.stats ().empty ()) {
+                        ret = ret + block.stats ().at (channel);
+                }
+                else {
+                        ret = ret + channelStats (block.channel (channel), size_t (from), size_t (to));
+                }
+        }
+
+        return ret;
+}
+
+/****************************************************************************/
+
 void BlockArray::clear ()
 {
         for (auto &levels : levels) {
@@ -9,41 +9,47 @@
 module;
 #include "common/constants.hh"
 #include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
 module logic.data;
 import logic.core;
 import logic.processing;
+import logic.util;
 
 namespace logic {
 
-// auto binaryToGray (auto num) { return num ^ (num >> 1); };
+namespace {
 
-DigitalFrontend::DigitalFrontend (IBackend *backend) : backend{backend} { backend->addObserver (this); }
+        int64_t ceilDiv (int64_t a, int64_t b) { return (a + b - 1) / b; }
 
-/****************************************************************************/
+} // namespace
 
-DigitalFrontend::~DigitalFrontend () { backend->removeObserver (this); }
+// auto binaryToGray (auto num) { return num ^ (num >> 1); };
 
-/****************************************************************************/
+DigitalFrontend::DigitalFrontend (IBackend *backend) : backend{backend} { backend->addObserver (this); }
 
-// Stream const &DigitalFrontend::group (size_t groupIdx, SampleIdx const &begin, SampleIdx const &end)
-// {
-//         ZoneScoped;
+/****************************************************************************/
 
-//         /*
-//          * TODO Better caching mechanism would be beneficial here. It would get more data
-//          * from the backend that was requested, and would return only a subrange / span.
-//          * - retrieve more (like 3x more than end-begin), store in cache
-//          * - remove cachedBegin and cachedEnd
-//          * - add a query method to teh `Stream` class that would check if provided range is
-//          *   covered by this stream.
-//          * - and resize cache automatically (if multiple groups per frontend is possible).
-//          */
-//         if (cachedBegin != begin || cachedEnd != end) {
-//                 cache.at (groupIdx) = backend->range (groupIdx, begin, end);
-//         }
+DigitalFrontend::~DigitalFrontend ()
+{
+        if (prefetcher.joinable ()) {
+                prefetcher.request_stop ();
+                prefetchCVar.notify_all ();
+                prefetcher.join ();
+        }
 
-//         return cache.at (groupIdx);
-// }
+        backend->removeObserver (this);
+}
 
 /****************************************************************************/
 
@@ -85,6 +91,504 @@ BlockArray::SubRange DigitalFrontend::range (size_t groupIdx, SampleIdx offset,
 
 /****************************************************************************/
 
+std::vector<ColumnEnvelope> DigitalFrontend::envelope (size_t groupIdx, size_t channel, SampleIdx begin, SampleIdx end, size_t pixelColumns) const
+{
+        ZoneScoped;
+        std::vector<ColumnEnvelope> ret (pixelColumns);
+        auto const w = end.get () - begin.get ();
+
+        if (pixelColumns == 0 || w <= 0) {
+                return ret;
+        }
+
+        // The coarsest level with at least 1 sample per column (`range` picks the level).
+        auto zoomOut = std::max<size_t> (size_t (w) / pixelColumns, 1);
+        auto blocks = backend->range (groupIdx, begin, end, zoomOut);
+
+        if (std::ranges::empty (blocks)) {
+                return ret;
+        }
+
+        if (bitsPerSample (blocks) != 1) {
+                throw Exception{"DigitalFrontend::envelope : only 1 bit per sample is supported."};
+        }
+
+        auto const n = int64_t (pixelColumns);
+        // Full resolution sample x belongs to the column floor ((x - begin) * n / w).
+        auto colStart = [&] (int64_t c) { return begin.get () + ceilDiv (c * w, n); };
+        std::optional<bool> prevBit; // Last sample of the previous column piece (possibly in the previous block).
+
+        for (Block const &block : blocks) {
+                // Block sample j covers [f + j * z, f + (j + 1) * z) full resolution samples.
+                auto const z = int64_t (block.zoomOut ());
+                auto const f = block.firstSampleNo ().get ();
+                auto const lo = std::max<int64_t> (ceilDiv (begin.get () - f, z), 0);
+                auto const hi = std::min<int64_t> (ceilDiv (end.get () - f, z), block.channelLength ().get ());
+
+                if (lo >= hi) {
+                        continue;
+                }
+
+                std::span<uint8_t const> data = block.channel (channel);
+                auto const length = int64_t (data.size () * CHAR_BIT); // Samples of this level.
+
+                for (auto j = lo; j < hi;) {
+                        auto c = std::min ((f + j * z - begin.get ()) * n / w, n - 1);
+                        auto jEnd = std::min (ceilDiv (colStart (c + 1) - f, z), hi);
+                        auto &col = ret.at (c);
+
+                        // Whole block within a column (zoomed out far) : already summarized.
+                        auto const s = (j == 0 && jEnd == length && channel < block.stats ().size ()) ? (block.stats ().at (channel))
+                                                                                                     : (channelStats (data, size_t (j), size_t (jEnd)));
+
+                        col.hasHigh |= s.high > 0;
+                        col.hasLow |= s.high < s.samples;
+                        col.edgesNo += uint32_t (s.edges) + uint32_t (prevBit && *prevBit != s.first); // Including the one on the left border.
+                        prevBit = s.last;
+                        j = jEnd;
+                }
+        }
+
+        return ret;
+}
+
+/****************************************************************************/
+
+size_t DigitalFrontend::TileKeyHash::operator() (TileKey const &k) const
+{
+        auto h = std::hash<int64_t>{}(k.tileIdx);
+        h ^= std::hash<size_t>{}(k.zoomOut) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<size_t>{}(k.channel) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<size_t>{}(k.groupIdx) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+}
+
+/****************************************************************************/
+
+std::shared_ptr<VertexTile const> DigitalFrontend::tile (size_t groupIdx, size_t channel, size_t zoomOut, int64_t tileIdx) const
+{
+        ZoneScoped;
+        TileKey key{groupIdx, channel, std::max<size_t> (zoomOut, 1), tileIdx};
+        TileConfig cfg;
+        uint64_t epoch{};
+        uint64_t gen{};
+
+        {
+                std::lock_guard lock{cacheMutex};
+
+                if (auto t = findTile (key)) {
+                        ++cacheStats.hits;
+                        return t;
+                }
+
+                ++cacheStats.misses;
+                cfg = tileConfig_;
+                epoch = cacheEpoch;
+                gen = generation (groupIdx);
+        }
+
+        // Rendered without the lock, so the prefetcher and onNewData are not blocked meanwhile.
+        auto t = renderTile (key, cfg);
+        std::lock_guard lock{cacheMutex};
+        insertTile (key, t, epoch, gen);
+        return t;
+}
+
+/****************************************************************************/
+
+std::shared_ptr<VertexTile const> DigitalFrontend::tryTile (size_t groupIdx, size_t channel, size_t zoomOut, int64_t tileIdx) const
+{
+        TileKey key{groupIdx, channel, std::max<size_t> (zoomOut, 1), tileIdx};
+
+        {
+                std::lock_guard lock{cacheMutex};
+
+                if (auto t = findTile (key)) {
+                        ++cacheStats.hits;
+                        return t;
+                }
+
+                ++cacheStats.misses;
+        }
+
+        {
+                std::lock_guard lock{prefetchMutex};
+                auto i = std::ranges::find (prefetchQueue, key);
+                bool wasUrgent = i != prefetchQueue.end () && size_t (std::distance (prefetchQueue.begin (), i)) < urgentNo;
+
+                if (i != prefetchQueue.end ()) {
+                        prefetchQueue.erase (i);
+                }
+
+                prefetchQueue.push_front (key); // Needed right now, so goes first.
+                urgentNo += size_t (!wasUrgent);
+        }
+
+        startPrefetcher ();
+        prefetchCVar.notify_one ();
+        return {};
+}
+
+/****************************************************************************/
+
+std::shared_ptr<VertexTile const> DigitalFrontend::findTile (TileKey const &key) const
+{
+        if (auto i = tiles.find (key); i != tiles.end ()) {
+                lru.splice (lru.begin (), lru, i->second);
+                return i->second->second;
+        }
+
+        return {};
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::insertTile (TileKey const &key, std::shared_ptr<VertexTile const> const &t, uint64_t epoch, uint64_t generation) const
+{
+        // Config changed or the backend got cleared while rendering.
+        if (epoch != cacheEpoch) {
+                return;
+        }
+
+        /*
+         * New data was notified while rendering, so onNewData has swept the `incomplete`
+         * already. Nothing would drop this tail later (e.g. the acquisition has ended).
+         */
+        if (!t->complete && generation != this->generation (key.groupIdx)) {
+                return;
+        }
+
+        eraseTile (key); // Could have been rendered by the other thread meanwhile.
+
+        if (!t->complete) {
+                incomplete.push_back (key);
+        }
+
+        lru.emplace_front (key, t);
+        tiles[key] = lru.begin ();
+        ++cacheStats.tilesNo;
+        cacheStats.bytes += t->vertices.capacity () * sizeof (float) + sizeof (VertexTile);
+        evict ();
+}
+
+/****************************************************************************/
+
+uint64_t DigitalFrontend::generation (size_t groupIdx) const { return (groupIdx < generations.size ()) ? (generations.at (groupIdx)) : (0); }
+
+/****************************************************************************/
+
+std::shared_ptr<VertexTile const> DigitalFrontend::renderTile (TileKey const &key, TileConfig const &cfg) const
+{
+        ZoneScoped;
+        auto t = std::make_shared<VertexTile> ();
+        auto sampleRate = backend->sampleRate (key.groupIdx);
+        auto const lengthFr = cfg.samplesPerTile * int64_t (key.zoomOut);
+        t->begin = SampleIdx{key.tileIdx * lengthFr, sampleRate};
+        t->length = SampleNum{lengthFr, sampleRate};
+
+        auto const channelLength = backend->channelLength (key.groupIdx).get ();
+        t->complete = channelLength >= t->begin.get () + lengthFr;
+
+        if (key.tileIdx < 0 || channelLength <= t->begin.get ()) {
+                return t;
+        }
+
+        auto blocks = backend->range (key.groupIdx, t->begin, t->length, key.zoomOut);
+
+        if (std::ranges::empty (blocks)) {
+                return t;
+        }
+
+        // `range` may have picked a finer level than requested. Worst case is 2 vertices per sample.
+        auto levelSamples = lengthFr / int64_t (std::ranges::begin (blocks)->zoomOut ());
+        t->vertices.resize (size_t (levelSamples + 2) * 4);
+        auto n = toPolyPoints (blocks, key.channel, t->begin, t->length, cfg.width, t->vertices, PolyPointsCfg{.height = cfg.height, .lineWidth = 1});
+        t->vertices.resize (n);
+        t->vertices.shrink_to_fit ();
+        return t;
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::eraseTile (TileKey const &key) const
+{
+        auto i = tiles.find (key);
+
+        if (i == tiles.end ()) {
+                return;
+        }
+
+        cacheStats.bytes -= i->second->second->vertices.capacity () * sizeof (float) + sizeof (VertexTile);
+        --cacheStats.tilesNo;
+        lru.erase (i->second);
+        tiles.erase (i);
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::evict () const
+{
+        // The most recent one always stays.
+        while (cacheStats.bytes > tileConfig_.memoryBudgetB && lru.size () > 1) {
+                auto key = lru.back ().first;
+                eraseTile (key);
+                std::erase (incomplete, key);
+                ++cacheStats.evictions;
+        }
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::setTileConfig (TileConfig const &c)
+{
+        std::lock_guard lock{cacheMutex};
+        tileConfig_ = c;
+        ++cacheEpoch;
+        lru.clear ();
+        tiles.clear ();
+        incomplete.clear ();
+        cacheStats.tilesNo = 0;
+        cacheStats.bytes = 0;
+}
+
+/****************************************************************************/
+
+TileCacheStats DigitalFrontend::tileCacheStats () const
+{
+        std::lock_guard lock{cacheMutex};
+        return cacheStats;
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::onNewData (DataChange const &change)
+{
+        newData.store (true);
+        std::lock_guard lock{cacheMutex};
+        auto const g = change.groupIdx;
+
+        if (generations.size () <= g) {
+                generations.resize (g + 1);
+        }
+
+        ++generations.at (g);
+
+        // Only the tail tiles were rendered from partial data.
+        std::erase_if (incomplete, [this, g] (TileKey const &key) {
+                if (key.groupIdx != g) {
+                        return false;
+                }
+
+                eraseTile (key);
+                return true;
+        });
+
+        if (!change.cleared) {
+                return;
+        }
+
+        // The samples are gone, everything rendered from this group is stale.
+        ++cacheEpoch;
+        std::erase_if (lru, [this, g] (auto const &entry) {
+                if (entry.first.groupIdx != g) {
+                        return false;
+                }
+
+                cacheStats.bytes -= entry.second->vertices.capacity () * sizeof (float) + sizeof (VertexTile);
+                --cacheStats.tilesNo;
+                tiles.erase (entry.first);
+                return true;
+        });
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::viewport (Viewport const &v)
+{
+        if (tileConfig_.samplesPerTile <= 0 || v.length.get () <= 0) {
+                return;
+        }
+
+        auto now = (v.time == std::chrono::steady_clock::time_point{}) ? (std::chrono::steady_clock::now ()) : (v.time);
+        auto zoomOut = std::max<size_t> (v.zoomOut, 1);
+        auto tileFr = double (tileConfig_.samplesPerTile) * double (zoomOut);
+        auto beginTiles = double (v.begin.get ()) / tileFr;
+
+        /*
+         * Smoothed motion. Velocity is in tiles (of the current zoom) per second, zoom trend
+         * is positive when zooming out. A single jerk of the mouse is not a trend, thus the
+         * exponential smoothing.
+         */
+        if (motion.valid) {
+                std::chrono::duration<double> dt = now - motion.time;
+
+                if (dt.count () > 0) {
+                        auto lastBeginTiles = double (motion.begin) / tileFr;
+                        motion.velocity = (1 - MOTION_ALPHA) * motion.velocity + MOTION_ALPHA * (beginTiles - lastBeginTiles) / dt.count ();
+                        motion.zoomTrend = (1 - MOTION_ALPHA) * motion.zoomTrend + MOTION_ALPHA * std::log2 (double (zoomOut) / double (motion.zoomOut));
+                }
+        }
+
+        motion = {.valid = true, .time = now, .begin = v.begin.get (), .zoomOut = zoomOut, .velocity = motion.velocity, .zoomTrend = motion.zoomTrend};
+
+        auto predicted = predict (v);
+
+        {
+                std::lock_guard lock{prefetchMutex};
+                // Old predictions are obsolete. Requests from tryTile (at the front) are kept though.
+                prefetchQueue.resize (std::min (prefetchQueue.size (), urgentNo));
+                std::ranges::copy (predicted, std::back_inserter (prefetchQueue));
+        }
+
+        startPrefetcher ();
+        prefetchCVar.notify_one ();
+}
+
+/****************************************************************************/
+
+std::vector<DigitalFrontend::TileKey> DigitalFrontend::predict (Viewport const &v) const
+{
+        std::vector<TileKey> keys;
+        auto channelLength = backend->channelLength (v.groupIdx).get ();
+
+        auto addRange = [&] (size_t zoomOut, int64_t first, int64_t last) {
+                auto tileFr = tileConfig_.samplesPerTile * int64_t (zoomOut);
+
+                for (auto t = first; t <= last; ++t) {
+                        if (t < 0 || t * tileFr >= channelLength) {
+                                continue;
+                        }
+
+                        for (auto ch : v.channels) {
+                                keys.push_back ({v.groupIdx, ch, zoomOut, t});
+                        }
+                }
+        };
+
+        auto zoomOut = std::max<size_t> (v.zoomOut, 1);
+        auto tileFr = tileConfig_.samplesPerTile * int64_t (zoomOut);
+        auto t0 = v.begin.get () / tileFr;
+        auto t1 = (v.begin.get () + v.length.get () - 1) / tileFr;
+
+        // Neighbours. More of them in the direction of the motion, the faster the more.
+        auto ahead = std::clamp (int64_t (std::ceil (std::abs (motion.velocity) * PREFETCH_HORIZON.count ())), int64_t{1}, MAX_AHEAD);
+
+        if (motion.velocity > MOTION_EPSILON) {
+                addRange (zoomOut, t1 + 1, t1 + ahead);
+                addRange (zoomOut, t0 - 1, t0 - 1);
+        }
+        else if (motion.velocity < -MOTION_EPSILON) {
+                for (auto t = t0 - 1; t >= t0 - ahead; --t) { // Nearest first.
+                        addRange (zoomOut, t, t);
+                }
+
+                addRange (zoomOut, t1 + 1, t1 + 1);
+        }
+        else {
+                addRange (zoomOut, t1 + 1, t1 + 1);
+                addRange (zoomOut, t0 - 1, t0 - 1);
+        }
+
+        // The next zoom level (the GUI zooms in steps of 2) covering the viewport.
+        auto nextZoomOut = zoomOut;
+
+        if (motion.zoomTrend > MOTION_EPSILON) {
+                nextZoomOut = zoomOut * 2;
+        }
+        else if (motion.zoomTrend < -MOTION_EPSILON && zoomOut > 1) {
+                nextZoomOut = zoomOut / 2;
+        }
+
+        if (nextZoomOut != zoomOut) {
+                auto nextTileFr = tileConfig_.samplesPerTile * int64_t (nextZoomOut);
+                addRange (nextZoomOut, v.begin.get () / nextTileFr, (v.begin.get () + v.length.get () - 1) / nextTileFr);
+        }
+
+        return keys;
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::startPrefetcher () const
+{
+        std::call_once (prefetcherOnce, [this] { prefetcher = std::jthread{[this] (std::stop_token const &stop) { prefetchLoop (stop); }}; });
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::prefetchLoop (std::stop_token const &stop) const
+{
+        setThreadName ("prefetch");
+
+        while (!stop.stop_requested ()) {
+                TileKey key;
+
+                {
+                        std::unique_lock lock{prefetchMutex};
+
+                        if (!prefetchCVar.wait (lock, stop, [this] { return !prefetchQueue.empty (); })) {
+                                break;
+                        }
+
+                        key = prefetchQueue.front ();
+                        prefetchQueue.pop_front ();
+                        urgentNo = (urgentNo > 0) ? (urgentNo - 1) : (0);
+                        prefetchBusy = true;
+                }
+
+                prefetchOne (key);
+
+                {
+                        std::lock_guard lock{prefetchMutex};
+                        prefetchBusy = false;
+                }
+
+                prefetchIdleCVar.notify_all ();
+        }
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::prefetchOne (TileKey const &key) const
+{
+        ZoneScopedN ("prefetch");
+        TileConfig cfg;
+        uint64_t epoch{};
+        uint64_t gen{};
+
+        {
+                std::lock_guard lock{cacheMutex};
+
+                if (tiles.contains (key)) {
+                        return;
+                }
+
+                cfg = tileConfig_;
+                epoch = cacheEpoch;
+                gen = generation (key.groupIdx);
+        }
+
+        try {
+                auto t = renderTile (key, cfg);
+                std::lock_guard lock{cacheMutex};
+                insertTile (key, t, epoch, gen);
+                ++cacheStats.prefetched;
+        }
+        catch (...) {
+                // Ignored. The render thread will get the same exception when it asks for the tile synchronously.
+        }
+}
+
+/****************************************************************************/
+
+void DigitalFrontend::waitForPrefetch () const
+{
+        std::unique_lock lock{prefetchMutex};
+        prefetchIdleCVar.wait (lock, [this] { return prefetchQueue.empty () && !prefetchBusy; });
+}
+
+/****************************************************************************/
+
 bool DigitalFrontend::isNewData () const
 {
         if (newData) {
@@ -0,0 +1,252 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <mutex>
+#include <stop_token>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+module logic.data;
+import logic.core;
+import logic.util;
+
+namespace logic {
+
+namespace {
+        constexpr size_t padding (size_t len) { return (alignof (RawJournalHeader) - len % alignof (RawJournalHeader)) % alignof (RawJournalHeader); }
+
+        void writeAll (int fd, Bytes const &buffer)
+        {
+                size_t written{};
+
+                while (written < buffer.size ()) {
+                        auto r = ::write (fd, buffer.data () + written, buffer.size () - written);
+
+                        if (r < 0) {
+                                if (errno == EINTR) {
+                                        continue;
+                                }
+
+                                throw Exception{std::format ("Raw journal write has failed: {}", std::strerror (errno))};
+                        }
+
+                        written += size_t (r);
+                }
+        }
+} // namespace
+
+/****************************************************************************/
+
+RawJournalWriter::RawJournalWriter (std::filesystem::path const &path, size_t writeBufferB) : writeBufferB{writeBufferB}
+{
+        if (fd = ::open (path.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644); fd < 0) {
+                throw Exception{std::format ("Could not open the raw journal {}: {}", path.string (), std::strerror (errno))};
+        }
+
+        writeBuffer.reserve (writeBufferB);
+        writerThread = std::jthread{[this] (std::stop_token const &stop) { writeLoop (stop); }};
+}
+
+/****************************************************************************/
+
+RawJournalWriter::~RawJournalWriter ()
+{
+        try {
+                flush ();
+        }
+        catch (...) {
+                // Nothing we can do in the destructor.
+        }
+
+        writerThread.request_stop ();
+        writerThread.join ();
+        ::close (fd);
+}
+
+/****************************************************************************/
+
+void RawJournalWriter::append (RawCompressedBlock const &block, bool compressed, std::chrono::steady_clock::time_point timestamp)
+{
+        ZoneScoped;
+
+        RawJournalHeader header{.flags = (compressed) ? (RawJournalHeader::COMPRESSED) : (0U),
+                                .timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds> (timestamp.time_since_epoch ()).count (),
+                                .lengthB = block.buffer.size (),
+                                .overrunsNo = block.overrunsNo,
+                                .bps = block.bps};
+
+        auto const *h = reinterpret_cast<uint8_t const *> (&header);
+        writeBuffer.insert (writeBuffer.end (), h, h + sizeof (header));
+        writeBuffer.insert (writeBuffer.end (), block.buffer.cbegin (), block.buffer.cend ());
+        writeBuffer.resize (writeBuffer.size () + padding (block.buffer.size ()));
+        ++entriesNo;
+
+        if (writeBuffer.size () >= writeBufferB) {
+                handOver ();
+        }
+}
+
+/****************************************************************************/
+
+void RawJournalWriter::handOver ()
+{
+        ZoneScoped;
+
+        {
+                std::unique_lock lock{mutex};
+                cVar.wait (lock, [this] { return !busy; }); // Only if the disk is slower than the data.
+
+                if (error) {
+                        std::rethrow_exception (std::exchange (error, nullptr));
+                }
+
+                if (writeBuffer.empty ()) {
+                        return;
+                }
+
+                std::swap (writeBuffer, inFlight); // inFlight was emptied by the writerThread, capacity stays.
+                busy = true;
+        }
+
+        cVar.notify_all ();
+}
+
+/****************************************************************************/
+
+void RawJournalWriter::flush ()
+{
+        ZoneScoped;
+        handOver ();
+        std::unique_lock lock{mutex};
+        cVar.wait (lock, [this] { return !busy; });
+
+        if (error) {
+                std::rethrow_exception (std::exchange (error, nullptr));
+        }
+}
+
+/****************************************************************************/
+
+void RawJournalWriter::writeLoop (std::stop_token const &stop)
+{
+        setThreadName ("RawJournal");
+
+        while (true) {
+                {
+                        std::unique_lock lock{mutex};
+
+                        if (!cVar.wait (lock, stop, [this] { return busy; })) {
+                                return;
+                        }
+                }
+
+                // The producer doesn't touch inFlight while busy.
+                std::exception_ptr e;
+
+                try {
+                        writeAll (fd, inFlight);
+                }
+                catch (...) {
+                        e = std::current_exception ();
+                }
+
+                {
+                        std::lock_guard lock{mutex};
+                        inFlight.clear ();
+                        busy = false;
+                        error = (e) ? (e) : (error);
+                }
+
+                cVar.notify_all ();
+        }
+}
+
+/****************************************************************************/
+
+RawJournalReader::RawJournalReader (std::filesystem::path const &path)
+{
+        int fd = ::open (path.c_str (), O_RDONLY);
+
+        if (fd < 0) {
+                throw Exception{std::format ("Could not open the raw journal {}: {}", path.string (), std::strerror (errno))};
+        }
+
+        struct stat st{};
+
+        if (::fstat (fd, &st) < 0) {
+                ::close (fd);
+                throw Exception{std::format ("Could not stat the raw journal {}: {}", path.string (), std::strerror (errno))};
+        }
+
+        mappedB = size_t (st.st_size);
+
+        if (mappedB > 0) {
+                void *p = ::mmap (nullptr, mappedB, PROT_READ, MAP_SHARED, fd, 0);
+
+                if (p == MAP_FAILED) {
+                        ::close (fd);
+                        throw Exception{std::format ("Could not mmap the raw journal {}: {}", path.string (), std::strerror (errno))};
+                }
+
+                ::madvise (p, mappedB, MADV_SEQUENTIAL);
+                mapped = static_cast<uint8_t const *> (p);
+        }
+
+        ::close (fd); // The mapping stays valid.
+
+        // Build the index. Only headers are touched.
+        size_t offset{};
+
+        while (offset + sizeof (RawJournalHeader) <= mappedB) {
+                auto const *header = reinterpret_cast<RawJournalHeader const *> (mapped + offset);
+
+                if (header->magic != RawJournalHeader::MAGIC) {
+                        throw Exception{std::format ("Raw journal {} is corrupted at offset {}", path.string (), offset)};
+                }
+
+                size_t next = offset + sizeof (RawJournalHeader) + header->lengthB + padding (header->lengthB);
+
+                if (next > mappedB) {
+                        break; // Torn write.
+                }
+
+                offsets.push_back (offset);
+                offset = next;
+        }
+}
+
+/****************************************************************************/
+
+RawJournalReader::~RawJournalReader ()
+{
+        if (mapped != nullptr) {
+                ::munmap (const_cast<uint8_t *> (mapped), mappedB);
+        }
+}
+
+/****************************************************************************/
+
+RawJournalEntry RawJournalReader::entryAt (size_t offset) const
+{
+        auto const *header = reinterpret_cast<RawJournalHeader const *> (mapped + offset);
+        return {.header = header, .data = {mapped + offset + sizeof (RawJournalHeader), header->lengthB}};
+}
+
+} // namespace logic
@@ -8,8 +8,16 @@
 
 module;
 #include "common/params.hh"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <mutex>
 #include <optional>
+#include <vector>
 module logic.peripheral;
+import logic.analysis;
+import logic.processing;
 
 namespace logic {
 
@@ -18,14 +26,23 @@ namespace logic {
 void AbstractDevice::notify (std::optional<bool> running, std::optional<Health> state)
 {
         if (running != std::nullopt) {
-                acquiring_ = *running;
+                if (*running && !acquiring_) {
+                        trigger_.reset (); // Before the data starts flowing.
+                        ++rawSession;      // Before acquiring_, so the ingest thread doesn't start the analyzers twice.
+                }
+
+                if (acquiring_.exchange (*running) != *running) {
+                        rawRequest = true;
+                        syncRaw (false); // Called from the libusb thread as well, so never wait for the ingest.
+                }
         }
 
         if (state != std::nullopt) {
                 health_ = *state;
         }
 
-        eventQueue ()->addEvent<DeviceStatusAlarm> (this, acquiring_, health_);
+        // Has to get through an error storm, the GUI must know the device has stopped.
+        eventQueue ()->addReliableEvent<DeviceStatusAlarm> (this, acquiring_, health_);
 }
 
 /****************************************************************************/
@@ -39,4 +56,163 @@ void AbstractDevice::writeAcquisitionParams (common::acq::Params const &params,
         acquisitionParams = params;
 }
 
+/****************************************************************************/
+
+void AbstractDevice::setTrigger (TriggerConfig const &config)
+{
+        if (acquiring ()) {
+                throw Exception{"AbstractDevice::setTrigger called on a running device."};
+        }
+
+        trigger_.configure (config);
+}
+
+/****************************************************************************/
+
+void AbstractDevice::addRawAnalyzer (IAnalyzer *analyzer)
+{
+        if (acquiring ()) {
+                throw Exception{"AbstractDevice::addRawAnalyzer called on a running device."};
+        }
+
+        std::lock_guard lock{rawMutex};
+        applyRawRequest (); // The pending stop (if any) goes to the old set.
+        rawAnalyzers.push_back (analyzer);
+}
+
+/****************************************************************************/
+
+void AbstractDevice::removeRawAnalyzer (IAnalyzer *analyzer)
+{
+        if (acquiring ()) {
+                throw Exception{"AbstractDevice::removeRawAnalyzer called on a running device."};
+        }
+
+        std::lock_guard lock{rawMutex};
+        applyRawRequest ();
+        std::erase (rawAnalyzers, analyzer);
+}
+
+/****************************************************************************/
+
+void AbstractDevice::runRaw (RawData const &rd)
+{
+        ZoneScoped;
+
+        {
+                std::lock_guard lock{rawMutex};
+                applyRawRequest ();
+
+                if (rawRunning) {
+                        for (auto *a : rawAnalyzers) {
+                                a->runRaw (rd);
+                        }
+                }
+        }
+
+        syncRaw (true); // Requested while we were busy.
+}
+
+/****************************************************************************/
+
+void AbstractDevice::syncRaw (bool wait)
+{
+        /*
+         * If the lock is taken, its owner (the ingest thread or another notify) finds
+         * the request after unlocking. Looped, because the request may come just before.
+         */
+        while (rawRequest) {
+                std::unique_lock lock{rawMutex, std::defer_lock};
+
+                if (wait) {
+                        lock.lock ();
+                }
+                else if (!lock.try_lock ()) {
+                        return;
+                }
+
+                applyRawRequest ();
+        }
+}
+
+/****************************************************************************/
+
+void AbstractDevice::applyRawRequest ()
+{
+        if (!rawRequest.exchange (false)) {
+                return;
+        }
+
+        auto const session = rawSession.load ();
+        bool const running = acquiring_;
+
+        // Stopped, or stopped and started again in the meantime.
+        if (rawRunning && (!running || session != rawStarted)) {
+                for (auto *a : rawAnalyzers) {
+                        a->stop ();
+                }
+
+                rawRunning = false;
+        }
+
+        if (!rawRunning && running) {
+                for (auto *a : rawAnalyzers) {
+                        a->start ();
+                }
+
+                rawRunning = true;
+                rawStarted = session;
+        }
+}
+
+/****************************************************************************/
+
+size_t AbstractDevice::ingest (RawCompressedBlock const &rcd, bool compressed, IBackend *backend)
+{
+        using Clock = TelemetryCollector::Clock;
+        using Stage = TelemetryCollector::Stage;
+        auto rearrangeStart = Clock::now ();
+
+        if (rcd.timestamp != Clock::time_point{}) {
+                telemetry_.record (Stage::queueToRearrange, rearrangeStart - rcd.timestamp);
+        }
+
+        // TODO for now only digital data gets rearranged
+        std::vector<Bytes> digitalChannels;
+
+        if (compressed) {
+                RawData rd = decompress (rcd);
+                runRaw (rd);
+                ZoneScopedN ("rearrange");
+                digitalChannels = rearrange (rd, acquisitionParams);
+        }
+        else {
+                runRaw (rcd);
+                ZoneScopedN ("rearrange");
+                digitalChannels = rearrange (rcd, acquisitionParams);
+        }
+
+        if (digitalChannels.empty ()) {
+                return 0;
+        }
+
+        // Pass-through unless configured. Idle data before the trigger never reaches the backend.
+        auto batches = trigger_.process (std::move (digitalChannels));
+        size_t samplesPerChannel{};
+
+        /*
+         * Consider locking granularity. But even if it is too coarse, the move operation
+         * below is so fast, that we aren't locked for too long.
+         */
+        for (auto &batch : batches) {
+                ZoneScopedN ("append");
+                samplesPerChannel += batch.front ().size () * CHAR_BIT; // Assuming 1 bit samples always.
+                backend->append (groupsIdx ().front (), std::move (batch));
+        }
+
+        telemetry_.record (Stage::rearrangeToAppend, Clock::now () - rearrangeStart);
+
+        return samplesPerChannel;
+}
+
 } // namespace logic
\ No newline at end of file
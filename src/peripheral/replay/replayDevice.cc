@@ -0,0 +1,219 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include "common/params.hh"
+#include <Tracy.hpp>
+#include <chrono>
+#include <climits>
+#include <format>
+#include <thread>
+#include <vector>
+module logic.peripheral;
+import logic.processing;
+import logic.util;
+
+namespace logic {
+using namespace std::chrono_literals;
+
+ReplayDevice::ReplayDevice (EventQueue *eventQueue, ReplayParams params) : eventQueue_{eventQueue}, params_{std::move (params)}
+{
+        // We have to have valid defaults.
+        acquisitionParams.digitalChannels = 8;
+        acquisitionParams.digitalSampleRate = 3'000'000;
+        acquisitionParams.digitalEncoding = common::acq::DigitalChannelEncoding::flexio;
+}
+
+/****************************************************************************/
+
+void ReplayDevice::setReplayParams (ReplayParams const &p)
+{
+        if (acquiring ()) {
+                throw Exception{"ReplayDevice::setReplayParams called on a running device."};
+        }
+
+        params_ = p;
+}
+
+/****************************************************************************/
+
+void ReplayDevice::start (IBackend *backend)
+{
+        if (acquiring ()) {
+                throw Exception{"Start called, but the device has been already started."};
+        }
+
+        // Finished on its own, nothing to wait for.
+        if (thread.joinable ()) {
+                thread.join ();
+        }
+
+        transfersNo = 0;
+        bytes = 0;
+        samplesPerChannel = 0;
+        elapsed = {};
+        telemetry ().reset ();
+        startTime = std::chrono::steady_clock::now ();
+        notify (true, Health::ok);
+
+        thread = std::thread{[backend, this, eventQueue = eventQueue ()] {
+                try {
+                        setThreadName ("ReplayDev");
+
+                        if (params_.journal.empty ()) {
+                                replaySynthesized (backend);
+                        }
+                        else {
+                                replayJournal (backend);
+                        }
+
+                        // Finished on its own (end of the journal or transfersNo reached).
+                        if (acquiring ()) {
+                                notify (false, Health::ok);
+                        }
+                }
+                catch (std::exception const &e) {
+                        notify (false, Health::error);
+                        eventQueue->addEvent<ErrorEvent> (std::format ("Exception caught in `ReplayDevice thread`: {}", e.what ()));
+                }
+                catch (...) {
+                        notify (false, Health::error);
+                        eventQueue->addEvent<ErrorEvent> (std::format ("Unknown (...) exception caught in `ReplayDevice thread`"));
+                }
+        }};
+}
+
+/****************************************************************************/
+
+void ReplayDevice::replayJournal (IBackend *backend)
+{
+        RawJournalReader reader{params_.journal};
+
+        if (reader.empty ()) {
+                return;
+        }
+
+        auto firstTimestamp = std::chrono::nanoseconds{reader.at (0).header->timestampNs};
+        RawCompressedBlock rcd;
+
+        for (auto const &entry : reader.entries ()) {
+                if (!acquiring ()) {
+                        break;
+                }
+
+                ZoneNamedN (replayDev, "replayDev", true);
+
+                if (params_.paced) {
+                        std::this_thread::sleep_until (startTime + (std::chrono::nanoseconds{entry.header->timestampNs} - firstTimestamp));
+                }
+
+                // The only copy. RawData is a vector based structure. Buffer capacity is reused.
+                rcd.bps = entry.header->bps;
+                rcd.overrunsNo = entry.header->overrunsNo;
+                rcd.buffer.assign (entry.data.begin (), entry.data.end ());
+                rcd.timestamp = std::chrono::steady_clock::now (); // "Received" now.
+                telemetry ().received (rcd.buffer.size (), rcd.timestamp);
+
+                account (rcd.buffer.size (), ingest (rcd, entry.header->compressed (), backend));
+        }
+}
+
+/****************************************************************************/
+
+void ReplayDevice::replaySynthesized (IBackend *backend)
+{
+        auto dc = acquisitionParams.digitalChannels;
+
+        if (dc == 0) {
+                throw Exception{"ReplayDevice : no digital channels configured."};
+        }
+
+        /*
+         * Transfers are prepared upfront, so the generation and encoding doesn't
+         * spoil the measurements. Square wave which frequency decreases with the
+         * channel number (like in the DemoDevice).
+         */
+        static constexpr size_t POOL_SIZE = 8;
+        std::vector<RawData> pool;
+        std::vector<Square> generators (dc);
+        auto sizePerChanBits = params_.transferLenB * CHAR_BIT / dc;
+
+        for (size_t p = 0; p < POOL_SIZE; ++p) {
+                std::vector<Bytes> channels;
+
+                for (auto i = 0U; i < dc; ++i) {
+                        channels.push_back (generators.at (i) (i + 1, i + 1, sizePerChanBits));
+                }
+
+                pool.push_back (encode (channels, acquisitionParams));
+        }
+
+        double delay = double (params_.transferLenB) * CHAR_BIT / (double (acquisitionParams.digitalSampleRate) * dc);
+        auto transferDelay = std::chrono::round<std::chrono::nanoseconds> (std::chrono::duration<double> (delay));
+
+        for (size_t i = 0; params_.transfersNo == 0 || i < params_.transfersNo; ++i) {
+                if (!acquiring ()) {
+                        break;
+                }
+
+                ZoneNamedN (replayDev, "replayDev", true);
+
+                if (params_.paced) {
+                        std::this_thread::sleep_until (startTime + i * transferDelay);
+                }
+
+                auto const &rd = pool.at (i % POOL_SIZE);
+                telemetry ().received (rd.buffer.size (), std::chrono::steady_clock::now ());
+                account (rd.buffer.size (), ingest (rd, false, backend));
+        }
+}
+
+/****************************************************************************/
+
+void ReplayDevice::account (size_t b, size_t s)
+{
+        ++transfersNo;
+        bytes += b;
+        samplesPerChannel += s;
+        elapsed = std::chrono::steady_clock::now () - startTime;
+
+        if (acquisitionParams.digitalSamplesPerChannelLimit > 0 && samplesPerChannel >= acquisitionParams.digitalSamplesPerChannelLimit) {
+                notify (false, Health::ok);
+        }
+}
+
+/****************************************************************************/
+
+ReplayStats ReplayDevice::stats () const
+{
+        return {.transfersNo = transfersNo,
+                .bytes = bytes,
+                .samplesPerChannel = samplesPerChannel,
+                .channelsNo = acquisitionParams.digitalChannels,
+                .elapsed = elapsed.load ()};
+}
+
+/****************************************************************************/
+
+void ReplayDevice::stop ()
+{
+        try {
+                if (acquiring ()) {
+                        notify (false, Health::ok);
+                }
+
+                if (thread.joinable ()) {
+                        thread.join ();
+                }
+        }
+        catch (std::exception const &e) {
+                eventQueue ()->addEvent<ErrorEvent> (std::format ("ReplayDevice stop exception: {}", e.what ()));
+        }
+}
+
+} // namespace logic
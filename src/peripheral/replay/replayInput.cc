@@ -0,0 +1,30 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <memory>
+module logic.peripheral;
+import :input.replay;
+
+namespace logic {
+
+ReplayInput::ReplayInput (EventQueue *eventQueue, ReplayParams const &params)
+    : AbstractInput{eventQueue}, device_{std::make_shared<ReplayDevice> (eventQueue, params)}
+{
+        eventQueue->setAlarm<DeviceAlarm> (device_);
+}
+
+/****************************************************************************/
+
+void ReplayInput::kill ()
+{
+        device_->stop ();
+        eventQueue ()->clearAlarm<DeviceAlarm> (device_);
+}
+
+} // namespace logic
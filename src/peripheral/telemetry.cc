@@ -0,0 +1,141 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <mutex>
+module logic.peripheral;
+
+namespace logic {
+
+void LatencyHistogram::add (std::chrono::nanoseconds d)
+{
+        auto ns = uint64_t (std::max<int64_t> (d.count (), 1));
+        auto idx = std::min<size_t> (std::bit_width (ns) - 1, BUCKETS_NO - 1);
+        ++buckets.at (idx);
+        ++count;
+        total += d;
+        min = std::min (min, d);
+        max = std::max (max, d);
+}
+
+/****************************************************************************/
+
+std::chrono::nanoseconds LatencyHistogram::percentile (double p) const
+{
+        if (count == 0) {
+                return {};
+        }
+
+        auto threshold = uint64_t (p * double (count));
+        uint64_t acc{};
+
+        for (size_t i = 0; i < BUCKETS_NO; ++i) {
+                acc += buckets.at (i);
+
+                if (acc > threshold || acc == count) {
+                        return std::min (std::chrono::nanoseconds{int64_t (1) << (i + 1)}, max);
+                }
+        }
+
+        return max;
+}
+
+/****************************************************************************/
+
+void TelemetryCollector::reset ()
+{
+        std::lock_guard lock{mutex};
+        data = {};
+        window = {};
+        windowHead = 0;
+        start = Clock::now ();
+}
+
+/****************************************************************************/
+
+void TelemetryCollector::received (size_t bytes, Clock::time_point timestamp)
+{
+        std::lock_guard lock{mutex};
+        ++data.transfersNo;
+        data.bytes += bytes;
+        window.at (windowHead) = {timestamp, bytes};
+        windowHead = (windowHead + 1) % ROLLING_WINDOW;
+}
+
+/****************************************************************************/
+
+void TelemetryCollector::record (Stage stage, std::chrono::nanoseconds d)
+{
+        std::lock_guard lock{mutex};
+
+        switch (stage) {
+        case Stage::callbackToQueue:
+                data.callbackToQueue.add (d);
+                break;
+        case Stage::queueToRearrange:
+                data.queueToRearrange.add (d);
+                break;
+        case Stage::rearrangeToAppend:
+                data.rearrangeToAppend.add (d);
+                break;
+        }
+}
+
+/****************************************************************************/
+
+Telemetry TelemetryCollector::snapshot () const
+{
+        std::lock_guard lock{mutex};
+        Telemetry t = data;
+        t.elapsed = Clock::now () - start;
+        t.rollingBps = rollingBpsNoLock ();
+        return t;
+}
+
+/****************************************************************************/
+
+double TelemetryCollector::rollingBps () const
+{
+        std::lock_guard lock{mutex};
+        return rollingBpsNoLock ();
+}
+
+/****************************************************************************/
+
+double TelemetryCollector::rollingBpsNoLock () const
+{
+        size_t samplesNo = std::min (data.transfersNo, ROLLING_WINDOW);
+
+        if (samplesNo < 2) {
+                return 0;
+        }
+
+        // windowHead - 1 is the newest, windowHead - samplesNo the oldest.
+        auto const &newest = window.at ((windowHead + ROLLING_WINDOW - 1) % ROLLING_WINDOW);
+        auto const &oldest = window.at ((windowHead + ROLLING_WINDOW - samplesNo) % ROLLING_WINDOW);
+        std::chrono::duration<double> span = newest.timestamp - oldest.timestamp;
+
+        if (span.count () <= 0) {
+                return 0;
+        }
+
+        size_t bytes{};
+
+        // The oldest sample only marks the beginning of the window.
+        for (size_t i = 1; i < samplesNo; ++i) {
+                bytes += window.at ((windowHead + ROLLING_WINDOW - i) % ROLLING_WINDOW).bytes;
+        }
+
+        return double (bytes) / span.count ();
+}
+
+} // namespace logic
@@ -17,6 +17,8 @@ module;
 #include <gsl/gsl>
 #include <libusb.h>
 #include <string>
+#include <thread>
+#include <vector>
 module logic.peripheral;
 import logic.util;
 
@@ -25,6 +27,9 @@ using namespace std::string_literals;
 using namespace common::usb;
 using namespace std::chrono;
 
+/// How often an idle (not acquiring) device worker checks its device.
+static constexpr auto IDLE_POLL_INTERVAL = 10ms;
+
 /****************************************************************************/
 
 UsbAsyncInput::UsbAsyncInput (EventQueue *eventQueue) : AbstractInput (eventQueue), usbFactory{eventQueue}
@@ -65,19 +70,27 @@ UsbAsyncInput::~UsbAsyncInput () noexcept
          * exceptions at all. Futures were chosen to catch the exceptions
          * in the first place.
          */
-        analyzeFuture.get ();
+        reapFuture.get ();
         acquireFuture.get ();
 
+        UsbHandles tmpHandles;
+        std::vector<UsbEntry> tmpRetired;
+
         {
                 std::lock_guard lock{mutex};
+                tmpHandles = std::move (handles);
+                tmpRetired = std::move (retired);
+                handles.clear ();
+                retired.clear ();
+        }
 
-                for (auto &[p, ent] : handles) {
-                        auto &[ph, dev] = ent;
-                        dev->resetDeviceHandle ();
-                        libusb_close (ph);
-                }
+        // Workers check `running_` which is false now.
+        for (auto &entry : tmpRetired) {
+                retire (std::move (entry));
+        }
 
-                handles.clear ();
+        for (auto &[p, entry] : tmpHandles) {
+                retire (std::move (entry));
         }
 
         libusb_hotplug_deregister_callback (nullptr, hotplugCallbackHandle);
@@ -111,11 +124,22 @@ int UsbAsyncInput::hotplugCallback (libusb_context * /* ctx */, libusb_device *d
                         }
                         else {
                                 std::shared_ptr<UsbDevice> device = input->usbFactory.create (desc.idVendor, desc.idProduct, devHandle);
+                                std::jthread worker{[input, device] (std::stop_token const &stop) { input->deviceLoop (stop, device); }};
+
                                 {
                                         std::lock_guard lock{input->mutex};
+
+                                        // Arrived twice without leaving. Don't join the old worker here, the reapLoop will.
+                                        if (auto i = input->handles.find (dev); i != input->handles.end ()) {
+                                                i->second.worker.request_stop ();
+                                                input->retired.push_back (std::move (i->second));
+                                                input->handles.erase (i);
+                                        }
+
                                         auto &entry = input->handles[dev];
-                                        entry.first = devHandle;
-                                        entry.second = device;
+                                        entry.handle = devHandle;
+                                        entry.device = device;
+                                        entry.worker = std::move (worker);
                                 }
 
                                 input->handlesCVar.notify_all ();
@@ -126,19 +150,17 @@ int UsbAsyncInput::hotplugCallback (libusb_context * /* ctx */, libusb_device *d
                         {
                                 std::lock_guard lock{input->mutex};
                                 auto &entry = input->handles.at (dev);
+                                eventQueue->clearAlarm<DeviceAlarm> (entry.device);
 
-                                auto &intDevice = entry.second;
-                                intDevice->resetDeviceHandle ();
-                                eventQueue->clearAlarm<DeviceAlarm> (intDevice);
-
-                                libusb_close (entry.first);
                                 /*
-                                 * Remove from the `handles` set. This releases (or prepares to release)
-                                 * all the resources. Removes the InternalHandle, deletes the shared_ptr
-                                 * device (if upper layers don't use it), which in turn calls libusb_close.
-                                 * If upper layers till hold a shared_pointer to the device, it gets
-                                 * destroyed when they release it.
+                                 * Don't join here, the worker may be in the middle of a heavy
+                                 * processing and we are in the libusb thread. The reapLoop will
+                                 * do that, and close the handle afterwards (the worker may still
+                                 * use it). The device itself is destroyed when the upper layers
+                                 * release their shared_ptrs.
                                  */
+                                entry.worker.request_stop ();
+                                input->retired.push_back (std::move (entry));
                                 input->handles.erase (dev);
                         }
 
@@ -189,51 +211,82 @@ void UsbAsyncInput::acquireLoop ()
 
 /****************************************************************************/
 
-void UsbAsyncInput::analyzeLoop (/* Queue<RawCompressedBlock> *rawQueue, IBackend *backend */)
+void UsbAsyncInput::deviceLoop (std::stop_token const &stop, std::shared_ptr<UsbDevice> const &device)
 {
         setThreadName ("Analyze");
+
         try {
-                while (true) {
-                        if (!running_.load ()) {
-                                break;
+                while (!stop.stop_requested () && running_.load ()) {
+                        if (!device->acquiring ()) {
+                                std::this_thread::sleep_for (IDLE_POLL_INTERVAL);
+                                continue;
                         }
 
-                        {
-                                /*
-                                 * Locking for the whole time prevents `handles` collection modification,
-                                 * specifficaly prevents element removal which can happen when you disconnect
-                                 * a device.
-                                 *
-                                 * TODO But this is inefficient because this would block the whole USB thread
-                                 * when a device (possibly other than the currently running one) gets deisconnected.
-                                 * And that would result in a timeout, since we are very tight on bandwidth.
-                                 *
-                                 * TODO Though... I could un-register the hot-plug callback if at least one device
-                                 * is acquiring.
-                                 */
-                                std::unique_lock lock{mutex};
-                                handlesCVar.wait (lock, [this] { return !handles.empty () || !running_; });
-
-                                for (auto &[deviceP, entryPair] : handles) {
-                                        entryPair.second->run ();
-                                }
-                        }
+                        /*
+                         * No lock here. The `device` is kept alive by the shared_ptr copy we own,
+                         * so the hotplug callback can remove it from the `handles` at any time.
+                         * UsbDevice::run blocks for at most ~10ms when the queue is empty.
+                         */
+                        device->run ();
                 }
         }
         catch (std::exception const &e) {
-                eventQueue ()->addEvent<ErrorEvent> (std::format ("Exception caught in `UsbAsyncInput::analyzeLoop`: {}", e.what ()));
+                eventQueue ()->addEvent<ErrorEvent> (std::format ("Exception caught in `UsbAsyncInput::deviceLoop`: {}", e.what ()));
         }
         catch (...) {
-                eventQueue ()->addEvent<ErrorEvent> (std::format ("Unknown (...) exception caught in `UsbAsyncInput::analyzeLoop`"));
+                eventQueue ()->addEvent<ErrorEvent> (std::format ("Unknown (...) exception caught in `UsbAsyncInput::deviceLoop`"));
         }
 }
 
 /****************************************************************************/
 
+void UsbAsyncInput::reapLoop ()
+{
+        setThreadName ("Reap");
+
+        while (true) {
+                std::vector<UsbEntry> tmp;
+
+                {
+                        std::unique_lock lock{mutex};
+                        handlesCVar.wait (lock, [this] { return !retired.empty () || !running_; });
+
+                        if (!running_.load ()) {
+                                break;
+                        }
+
+                        tmp = std::move (retired);
+                        retired.clear ();
+                }
+
+                // Outside the lock.
+                for (auto &entry : tmp) {
+                        retire (std::move (entry));
+                }
+        }
+}
+
+/****************************************************************************/
+
+void UsbAsyncInput::retire (UsbEntry &&entry)
+{
+        entry.worker.request_stop ();
+
+        if (entry.worker.joinable ()) {
+                entry.worker.join ();
+        }
+
+        // Nobody runs the device now.
+        entry.device->resetDeviceHandle ();
+        libusb_close (entry.handle);
+}
+
+/****************************************************************************/
+
 void UsbAsyncInput::run (/* Queue<RawCompressedBlock> *rawQueue, IBackend *backend */)
 {
-        // Futures are created for exception handling. TODO change to threads
-        analyzeFuture = std::async (std::launch::async, &UsbAsyncInput::analyzeLoop, this /* , rawQueue, backend */);
+        // Futures are created for exception handling. Device workers are started in the hotplugCallback.
+        reapFuture = std::async (std::launch::async, &UsbAsyncInput::reapLoop, this);
         acquireFuture = std::async (std::launch::async, &UsbAsyncInput::acquireLoop, this);
 }
 
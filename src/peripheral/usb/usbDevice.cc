@@ -12,11 +12,14 @@ module;
 #include "common/params.hh"
 #include "common/stats.hh"
 #include <Tracy.hpp>
+#include <chrono>
+#include <climits>
 #include <cstdint>
 #include <cstdlib>
 #include <format>
 #include <libusb.h>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 module logic.peripheral;
@@ -24,11 +27,28 @@ import logic.processing;
 
 namespace logic {
 
+UsbDevice::UsbDevice (EventQueue *eventQueue, libusb_device_handle *dev)
+    : UsbDevice{eventQueue, dev, std::make_unique<LibusbTransport> (&deviceHandle_, common::usb::IN_EP, common::usb::TIMEOUT_MS)}
+{
+}
+
+/****************************************************************************/
+
+UsbDevice::UsbDevice (EventQueue *eventQueue, libusb_device_handle *dev, std::unique_ptr<IUsbTransport> transport)
+    : deviceHandle_{dev}, transport_{std::move (transport)}, transfers (USB_BULK_TRANSFER_POOL_SIZE), eventQueue_{eventQueue}
+{
+}
+
+/****************************************************************************/
+
 UsbDevice::~UsbDevice ()
 {
+        // No callbacks after this point.
+        transport_->close ();
+
         // Device handles are closed in in the UsbAbstractInput which owns them.
         for (auto *transfer : transfers) {
-                libusb_free_transfer (transfer);
+                transport_->freeTransfer (transfer);
         }
 }
 
@@ -44,8 +64,13 @@ void UsbDevice::start (IBackend *backend)
                 // std::lock_guard lock{mutex};
                 setBackend (backend);
 
-                if (!transmissionParams_.discardRaw) {
-                        queue_.start ();
+                {
+                        std::lock_guard lock{journalMutex};
+                        journal_.reset (); // Flushes the previous one if any.
+
+                        if (!transmissionParams_.rawJournal.empty ()) {
+                                journal_ = std::make_unique<RawJournalWriter> (transmissionParams_.rawJournal);
+                        }
                 }
 
                 if (transmissionParams_.singleTransferLenB == 0) {
@@ -53,29 +78,49 @@ void UsbDevice::start (IBackend *backend)
                         throw Exception{"Can't send an USB transfer of length 0."};
                 }
 
-                singleTransfer.resize (transmissionParams_.singleTransferLenB);
+                if (inFlight > 0) {
+                        throw Exception{"Start called, but transfers from the previous acquisition haven't returned yet."};
+                }
+
+                transferBuffers.resize (USB_BULK_TRANSFER_POOL_SIZE);
+
+                for (auto &buf : transferBuffers) {
+                        buf.resize (transmissionParams_.singleTransferLenB);
+                }
         }
 
         acquisitionStopRequest = false;
         totalSizePerChan = 0;
         dropTransfer = true;
-
-        for (auto *transfer : transfers) {
-                if (transfer = libusb_alloc_transfer (0); transfer == nullptr) {
-                        /*
-                         * This is called from an user thread (via UsbAsyncInput::start) so we are
-                         * safe to throw an exception.
-                         */
-                        notify (false, Health::error);
-                        throw Exception{"Libusb could not instantiate a new transfer using `libusb_alloc_transfer`"};
+        telemetry ().reset ();
+
+        for (size_t i = 0; i < transfers.size (); ++i) {
+                auto *&transfer = transfers.at (i);
+
+                // Transfers are allocated once and reused in the subsequent acquisitions.
+                if (transfer == nullptr) {
+                        if (transfer = transport_->allocTransfer (); transfer == nullptr) {
+                                /*
+                                 * This is called from an user thread (via UsbAsyncInput::start) so we are
+                                 * safe to throw an exception.
+                                 */
+                                notify (false, Health::error);
+                                throw Exception{"Could not instantiate a new USB transfer"};
+                        }
                 }
 
-                libusb_fill_bulk_transfer (transfer, deviceHandle (), common::usb::IN_EP, singleTransfer.data (), singleTransfer.size (),
-                                           &UsbDevice::transferCallback, this, common::usb::TIMEOUT_MS);
+                transfer->buffer = transferBuffers.at (i).data ();
+                transfer->length = transferBuffers.at (i).size ();
+                transfer->userData = this;
+                transfer->callback = &UsbDevice::transferCallback;
+
+                ++inFlight;
 
-                if (auto r = libusb_submit_transfer (transfer); r < 0) {
+                if (auto r = transport_->submit (transfer); r < 0) {
+                        --inFlight;
+                        acquisitionStopRequest = true; // Let the already submitted ones wind down.
                         notify (false, Health::error);
-                        throw Exception{"`libusb_submit_transfer` has failed. Code: " + std::string{libusb_error_name (r)}};
+                        throw Exception{"USB transfer submission has failed. Code: " + transport_->errorName (r)};
                 }
         }
 
@@ -99,10 +144,8 @@ void UsbDevice::run ()
          * in turn checks for atomic running_ flag and throws if running_ is
          * true. UsbDevice::run at the other hand, runs only when running_ is
          * true, so they are mutually exclusive.
-         *
-         * queue->start () called in UsbDevice::start
          */
-        auto rcd = (transmissionParams_.discardRaw) ? (queue ().pop ()) : (queue ().next ());
+        auto rcd = queue ().pop ();
 
         if (!rcd) {
                 return;
@@ -111,39 +154,22 @@ void UsbDevice::run ()
         ZoneScopedN ("anaysis");
         TracyPlot ("rawQueueSize", int64_t (queue ().size ()));
 
-        RawData rd;
+        {
+                std::lock_guard lock{journalMutex};
 
-        if (transmissionParams_.decompress) {
-                rd = decompress (*rcd);
-                rcd->clear ();
-        }
-        else {
-                rd = std::move (*rcd);
+                if (journal_) {
+                        journal_->append (*rcd, transmissionParams_.decompress, rcd->timestamp);
+                }
         }
 
         // if (strategy != nullptr) {
         //         strategy->runRaw (rd);
         // }
 
-        // TODO for now only digital data gets rearranged
-        std::vector<Bytes> digitalChannels;
-
-        {
-                ZoneScopedN ("rearrange");
-                digitalChannels = rearrange (rd, acquisitionParams);
-        }
-
-        /*
-         * Consider locking granularity. But even if it is too coarse, the move operation
-         * below is so fast, that we aren't locked for too long.
-         */
-        {
-                ZoneScopedN ("append");
-                totalSizePerChan += digitalChannels.front ().size () * CHAR_BIT; // Assuming 1 bit samples always.
-                backend_->append (groupsIdx ().front (), std::move (digitalChannels));
-        }
+        totalSizePerChan += ingest (*rcd, transmissionParams_.decompress, backend_);
 
         if (acquisitionParams.digitalSamplesPerChannelLimit > 0 && totalSizePerChan >= acquisitionParams.digitalSamplesPerChannelLimit) {
+                UsbDevice::stop (); // Stop re-submitting the transfers. Flushes the journal.
                 notify (false, Health::ok);
         }
 
@@ -168,7 +194,30 @@ void UsbDevice::run ()
 
 /****************************************************************************/
 
-void UsbDevice::stop () { acquisitionStopRequest = true; }
+void UsbDevice::stop ()
+{
+        acquisitionStopRequest = true;
+
+        // They return with TransferStatus::cancelled, and the last one reports the stop.
+        for (auto *transfer : transfers) {
+                if (transfer != nullptr) {
+                        transport_->cancel (transfer);
+                }
+        }
+
+        flushJournal ();
+}
+
+/****************************************************************************/
+
+void UsbDevice::flushJournal ()
+{
+        std::lock_guard lock{journalMutex};
+
+        if (journal_) {
+                journal_->flush ();
+        }
+}
 
 /****************************************************************************/
 
@@ -201,93 +250,97 @@ void UsbDevice::open (UsbInterface const &info)
 
 /****************************************************************************/
 
-void UsbDevice::transferCallback (libusb_transfer *transfer)
+void UsbDevice::transferCallback (UsbTransfer *transfer)
 {
         ZoneScopedN ("transferCallback");
 
-        auto *h = reinterpret_cast<UsbDevice *> (transfer->user_data);
-        // We assume transmisionParams are already set.
-        auto transferLen = h->transmissionParams_.singleTransferLenB;
+        auto timestamp = TelemetryCollector::Clock::now ();
+        auto *h = static_cast<UsbDevice *> (transfer->userData);
+        auto transferLen = transfer->length;
+        auto stillInFlight = --h->inFlight;
 
-        if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        if (h->acquisitionStopRequest) {
+                /*
+                 * Cancelled by `stop` (or returned just after it). We don't re-submit, and
+                 * report the stop when the last one returns. Transfers are never freed here
+                 * (freeing the ones in flight crashed the app), they are reused on the next
+                 * start.
+                 */
+                if (stillInFlight == 0) {
+                        h->notify (false, {});
+                        TracyMessageL ("stop request");
+                }
+
+                return;
+        }
+
+        if (transfer->status != TransferStatus::completed) {
                 /*
                  * We're in the `UsbAsyncInput::acquireLoop ()` thread now, so I'm
                  * reporting errors through eventQueue.
                  */
-                h->eventQueue ()->addEvent<ErrorEvent> (
-                        std::format ("USB transfer status error Code: {}", libusb_error_name (transfer->status)));
+                h->acquisitionStopRequest = true; // The rest of the transfers won't be re-submitted.
+                h->eventQueue ()->addEvent<ErrorEvent> (std::format ("USB transfer status error Code: {}", statusName (transfer->status)));
                 h->notify (false, Health::error);
                 TracyMessageL ("!completed");
                 return;
         }
 
-        if (h->acquisitionStopRequest) {
-                for (auto *transfer : h->transfers) {
-                        // libusb_cancel_transfer (transfer); // TODO This crashes the app. Why?
-                        libusb_free_transfer (transfer);
-                }
-
-                h->notify (false, Health::ok);
-                TracyMessageL ("stop request");
-                return;
-        }
-
-        if (size_t (transfer->actual_length) != transferLen) {
+        if (transfer->actualLength != transferLen) {
                 // Lotys of code in upper layers depend on blocks of equal length.
+                h->acquisitionStopRequest = true;
                 h->eventQueue ()->addEvent<ErrorEvent> ("Received data size != requested data size.");
                 h->notify (false, Health::error);
                 TracyMessageL ("rx len mismatch");
                 return;
         }
 
-        // auto now = high_resolution_clock::now ();
-        // benchmarkB += singleTransfer.size ();
+        h->telemetry ().received (transfer->actualLength, timestamp);
+        double bps = h->telemetry ().rollingBps () * CHAR_BIT;
+        TracyPlot ("usbMbps", bps / 1e6);
 
-        {
-                // std::lock_guard lock{mutex};
-                // allTransferedB += singleTransfer.size ();
+        /*
+         * Warning! I made a terible mistake here, the one which takes
+         * hours to debug and drives you crazy. In my case it took me 12
+         * hours over 4 days to figure it out. The lines you see below
+         * originally read:
+         *
+         * RawCompressedBlock rcd{mbps, 0, std::move (h->singleTransfer)};
+         * ...
+         * h->singleTransfer = Bytes (transferLen);
+         *
+         * Which first destroyed the h->singleTransfer and then immediately
+         * re-created it. But I ignored the fact that in the start method the
+         * libusb_fill_bulk_transfer is given the original h->singleTransfer
+         * memory address and stores it indefinitely. So the next time the
+         * libusb_submit_transfer was called it tried to fill that original,
+         * not existing memory buffer.
+         *
+         * Another problem here, was that libusb_submit_transfer was called
+         * BEFORE the h->singleTransfer was copied (actually moved) to the
+         * final queue.
+         *
+         * Now every transfer has its own buffer (transferBuffers) and the same
+         * rule applies : copy, don't move.
+         */
+        if (h->dropTransfer) {
+                TracyMessageL ("dropped");
+                h->dropTransfer = false; // Ditch first dummy transfer (used to start the acq)
         }
-
-        if (!h->singleTransfer.empty ()) {
-                // auto mbps = (double (benchmarkB) / double (duration_cast<microseconds> (now - *startPoint).count ())) * 8;
-                double mbps = 0;
-
-                /*
-                 * Warning! I made a terible mistake here, the one which takes
-                 * hours to debug and drives you crazy. In my case it took me 12
-                 * hours over 4 days to figure it out. The lines you see below
-                 * originally read:
-                 *
-                 * RawCompressedBlock rcd{mbps, 0, std::move (h->singleTransfer)};
-                 * ...
-                 * h->singleTransfer = Bytes (transferLen);
-                 *
-                 * Which first destroyed the h->singleTransfer and then immediately
-                 * re-created it. But I ignored the fact that in the start method the
-                 * libusb_fill_bulk_transfer is given the original h->singleTransfer
-                 * memory address and stores it indefinitely. So the next time the
-                 * libusb_submit_transfer was called it tried to fill that original,
-                 * not existing memory buffer.
-                 *
-                 * Another problem here, was that libusb_submit_transfer was called
-                 * BEFORE the h->singleTransfer was copied (actually moved) to the
-                 * final queue.
-                 */
-                if (h->dropTransfer) {
-                        TracyMessageL ("dropped");
-                        h->dropTransfer = false; // Ditch first dummy transfer (used to start the acq)
-                }
-                else {
-                        RawCompressedBlock rcd{mbps, 0, h->singleTransfer};
-                        h->queue_.push (std::move (rcd)); // Lock protected
-                        h->singleTransfer.resize (transferLen);
-                        TracyMessageL ("pushed");
-                }
+        else {
+                RawCompressedBlock rcd{bps, 0, Bytes (transfer->buffer, transfer->buffer + transfer->actualLength), timestamp};
+                h->queue_.push (std::move (rcd)); // Lock protected
+                h->telemetry ().record (TelemetryCollector::Stage::callbackToQueue, TelemetryCollector::Clock::now () - timestamp);
+                TracyMessageL ("pushed");
         }
 
         // Only after finishing the data gathering may we re-start the transfer.
-        if (auto rc = libusb_submit_transfer (transfer); rc < 0) {
-                auto msg = std::format ("libusb_submit_transfer status error Code: {}", libusb_error_name (rc));
+        ++h->inFlight;
+
+        if (auto rc = h->transport_->submit (transfer); rc < 0) {
+                --h->inFlight;
+                h->acquisitionStopRequest = true;
+                auto msg = std::format ("USB transfer re-submit error Code: {}", h->transport_->errorName (rc));
                 h->notify (false, Health::error);
                 h->eventQueue ()->addEvent<ErrorEvent> (msg);
                 TracyMessageL ("submit error");
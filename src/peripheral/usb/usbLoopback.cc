@@ -0,0 +1,214 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <span>
+#include <thread>
+module logic.peripheral;
+import logic.util;
+
+namespace logic {
+
+LoopbackTransport::LoopbackTransport (LoopbackParams p) : params{std::move (p)}
+{
+        thread = std::thread{&LoopbackTransport::loop, this};
+}
+
+/****************************************************************************/
+
+LoopbackTransport::~LoopbackTransport () { close (); }
+
+/****************************************************************************/
+
+void LoopbackTransport::close ()
+{
+        {
+                std::lock_guard lock{mutex};
+                running = false;
+                pending.clear ();
+        }
+
+        cVar.notify_all ();
+
+        if (thread.joinable () && thread.get_id () != std::this_thread::get_id ()) {
+                thread.join ();
+        }
+}
+
+/****************************************************************************/
+
+int LoopbackTransport::submit (UsbTransfer *transfer)
+{
+        auto now = Clock::now ();
+
+        {
+                std::lock_guard lock{mutex};
+
+                if (!running) {
+                        return CLOSED;
+                }
+
+                pending.push_back ({transfer, now});
+                stats_.inFlightMax = std::max (stats_.inFlightMax, pending.size ());
+
+                // Re-submitted from within the callback.
+                if (transfer == inCallback) {
+                        auto resubmit = std::chrono::duration_cast<std::chrono::nanoseconds> (now - callbackStart);
+                        stats_.resubmitTotal += resubmit;
+                        stats_.resubmitMax = std::max (stats_.resubmitMax, resubmit);
+                        ++stats_.resubmits;
+                }
+        }
+
+        cVar.notify_all ();
+        return 0;
+}
+
+/****************************************************************************/
+
+int LoopbackTransport::cancel (UsbTransfer *transfer)
+{
+        std::lock_guard lock{mutex};
+        auto i = std::ranges::find (pending, transfer, &Pending::transfer);
+
+        if (i == pending.end ()) {
+                return NOT_FOUND;
+        }
+
+        i->cancelled = true;
+        cVar.notify_all ();
+        return 0;
+}
+
+/****************************************************************************/
+
+LoopbackStats LoopbackTransport::stats () const
+{
+        std::lock_guard lock{mutex};
+        return stats_;
+}
+
+/****************************************************************************/
+
+void LoopbackTransport::loop ()
+{
+        setThreadName ("Loopback");
+        std::minstd_rand rng{params.seed};
+        std::uniform_real_distribution<double> probability{0.0, 1.0};
+        std::uniform_int_distribution<int64_t> jitter{-params.jitter.count (), params.jitter.count ()};
+        Clock::time_point busFree = Clock::now ();
+
+        while (true) {
+                Pending p;
+
+                {
+                        std::unique_lock lock{mutex};
+                        cVar.wait (lock, [this] { return !pending.empty () || !running; });
+
+                        if (!running) {
+                                break;
+                        }
+
+                        p = pending.front (); // Stays there (only we pop), so `cancel` can still mark it.
+                }
+
+                ZoneScopedN ("loopback");
+                UsbTransfer *t = p.transfer;
+
+                /*
+                 * Completion time. The bus is a single pipe, so the transfer can't complete
+                 * earlier than the previous one plus the time needed to send the data.
+                 */
+                auto latency = std::max (params.latency + std::chrono::nanoseconds{jitter (rng)}, std::chrono::nanoseconds{});
+                auto busy = (params.bytesPerSecond > 0)
+                        ? (std::chrono::round<std::chrono::nanoseconds> (std::chrono::duration<double> (double (t->length) / params.bytesPerSecond)))
+                        : (std::chrono::nanoseconds{});
+
+                auto completion = std::max (p.submitted + latency, busFree + busy);
+
+                {
+                        std::unique_lock lock{mutex};
+                        cVar.wait_until (lock, completion, [this] { return !running || pending.front ().cancelled; });
+
+                        if (!running) {
+                                break;
+                        }
+
+                        p = pending.front ();
+                        pending.pop_front ();
+                }
+
+                busFree = std::min (completion, Clock::now ()); // Cancelled ones free the bus early.
+
+                if (p.cancelled) {
+                        t->status = TransferStatus::cancelled;
+                        t->actualLength = 0;
+                }
+                else if (probability (rng) < params.errorProbability) {
+                        t->status = TransferStatus::error;
+                        t->actualLength = 0;
+                }
+                else {
+                        t->status = TransferStatus::completed;
+                        t->actualLength = t->length;
+
+                        if (t->length > 0 && probability (rng) < params.shortTransferProbability) {
+                                t->actualLength = std::uniform_int_distribution<size_t>{0, t->length - 1}(rng);
+                        }
+
+                        if (params.generator) {
+                                params.generator (std::span{t->buffer, t->actualLength});
+                        }
+                }
+
+                auto cs = Clock::now ();
+
+                {
+                        std::lock_guard lock{mutex};
+                        inCallback = t;
+                        callbackStart = cs;
+                        ++stats_.completed;
+                        stats_.bytes += t->actualLength;
+                        stats_.errors += (t->status == TransferStatus::error) ? (1) : (0);
+                        stats_.cancelled += (t->status == TransferStatus::cancelled) ? (1) : (0);
+                        stats_.shortTransfers += (t->status == TransferStatus::completed && t->actualLength < t->length) ? (1) : (0);
+                }
+
+                t->callback (t);
+                auto ce = Clock::now ();
+
+                {
+                        std::lock_guard lock{mutex};
+                        inCallback = nullptr;
+                        auto cd = std::chrono::duration_cast<std::chrono::nanoseconds> (ce - cs);
+                        stats_.callbackTotal += cd;
+                        stats_.callbackMax = std::max (stats_.callbackMax, cd);
+                        stats_.elapsed = ce - start;
+                }
+        }
+}
+
+/****************************************************************************/
+
+LoopbackDevice::LoopbackDevice (EventQueue *eventQueue, std::unique_ptr<LoopbackTransport> transport)
+    : UsbDevice{eventQueue, nullptr, std::move (transport)}
+{
+        // UsbDevice owns it now, but we keep a typed pointer for the stats.
+        loopback_ = static_cast<LoopbackTransport *> (&UsbDevice::transport ());
+        acquisitionParams.digitalChannels = 8;
+        acquisitionParams.digitalSampleRate = 3'000'000;
+        acquisitionParams.digitalEncoding = common::acq::DigitalChannelEncoding::flexio;
+}
+
+} // namespace logic
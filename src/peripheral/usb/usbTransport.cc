@@ -0,0 +1,209 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <libusb.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+module logic.peripheral;
+
+namespace logic {
+
+LibusbTransport::~LibusbTransport ()
+{
+        close ();
+        std::vector<Slot *> tmp;
+
+        {
+                std::lock_guard lock{state->mutex};
+                tmp = slots;
+        }
+
+        // Owner forgot to free them.
+        for (auto *slot : tmp) {
+                freeTransfer (&slot->transfer);
+        }
+}
+
+/****************************************************************************/
+
+UsbTransfer *LibusbTransport::allocTransfer ()
+{
+        auto *lt = libusb_alloc_transfer (0);
+
+        if (lt == nullptr) {
+                return nullptr;
+        }
+
+        auto *slot = new Slot{.impl = lt, .state = state};
+        slot->transfer.impl = slot;
+        lt->user_data = slot;
+
+        std::lock_guard lock{state->mutex};
+        slots.push_back (slot);
+        return &slot->transfer;
+}
+
+/****************************************************************************/
+
+void LibusbTransport::freeTransfer (UsbTransfer *transfer)
+{
+        if (transfer == nullptr) {
+                return;
+        }
+
+        auto *slot = static_cast<Slot *> (transfer->impl);
+
+        {
+                std::lock_guard lock{state->mutex};
+                std::erase (slots, slot);
+
+                // Abandoned by `close`. libusb still owns it, the callback will free it.
+                if (slot->inFlight) {
+                        slot->freeOnReturn = true;
+                        return;
+                }
+        }
+
+        destroy (slot);
+}
+
+/****************************************************************************/
+
+void LibusbTransport::destroy (Slot *slot)
+{
+        libusb_free_transfer (slot->impl);
+        delete slot;
+}
+
+/****************************************************************************/
+
+int LibusbTransport::submit (UsbTransfer *transfer)
+{
+        auto *slot = static_cast<Slot *> (transfer->impl);
+        std::lock_guard lock{state->mutex};
+
+        if (state->closed) {
+                return CLOSED;
+        }
+
+        // Filling is cheap (just assignments), so we do it every time instead of keeping two structs in sync.
+        libusb_fill_bulk_transfer (slot->impl, *deviceHandle, endpoint, transfer->buffer, int (transfer->length), &LibusbTransport::libusbCallback,
+                                   slot, timeoutMs);
+
+        if (auto r = libusb_submit_transfer (slot->impl); r < 0) {
+                return r;
+        }
+
+        slot->inFlight = true;
+        ++state->busy;
+        return 0;
+}
+
+/****************************************************************************/
+
+int LibusbTransport::cancel (UsbTransfer *transfer)
+{
+        auto *slot = static_cast<Slot *> (transfer->impl);
+        std::lock_guard lock{state->mutex};
+
+        /*
+         * Never frees anything (freeing the transfers in flight is what used to crash
+         * the app). Completion of the cancelled transfer gets reported to the callback
+         * from the event thread as usual.
+         */
+        return (slot->inFlight) ? (libusb_cancel_transfer (slot->impl)) : (LIBUSB_ERROR_NOT_FOUND);
+}
+
+/****************************************************************************/
+
+void LibusbTransport::close ()
+{
+        std::unique_lock lock{state->mutex};
+        state->closed = true;
+
+        for (auto *slot : slots) {
+                if (slot->inFlight) {
+                        libusb_cancel_transfer (slot->impl);
+                }
+        }
+
+        if (state->eventThread == std::this_thread::get_id ()) {
+                return;
+        }
+
+        // Cancelled transfers return quickly, but only if somebody handles the events.
+        state->cVar.wait_for (lock, std::chrono::milliseconds{2 * timeoutMs}, [this] { return state->busy == 0; });
+}
+
+/****************************************************************************/
+
+void LibusbTransport::libusbCallback (libusb_transfer *lt)
+{
+        auto *slot = static_cast<Slot *> (lt->user_data);
+        auto *t = &slot->transfer;
+        t->actualLength = size_t (lt->actual_length);
+
+        switch (lt->status) {
+        case LIBUSB_TRANSFER_COMPLETED:
+                t->status = TransferStatus::completed;
+                break;
+        case LIBUSB_TRANSFER_TIMED_OUT:
+                t->status = TransferStatus::timedOut;
+                break;
+        case LIBUSB_TRANSFER_CANCELLED:
+                t->status = TransferStatus::cancelled;
+                break;
+        case LIBUSB_TRANSFER_STALL:
+                t->status = TransferStatus::stall;
+                break;
+        case LIBUSB_TRANSFER_NO_DEVICE:
+                t->status = TransferStatus::noDevice;
+                break;
+        case LIBUSB_TRANSFER_OVERFLOW:
+                t->status = TransferStatus::overflow;
+                break;
+        default:
+                t->status = TransferStatus::error;
+                break;
+        }
+
+        auto st = slot->state; // The transport may be gone if we were abandoned.
+
+        {
+                std::lock_guard lock{st->mutex};
+                st->eventThread = std::this_thread::get_id ();
+                slot->inFlight = false;
+
+                if (st->closed) {
+                        --st->busy;
+                        st->cVar.notify_all ();
+
+                        if (slot->freeOnReturn) {
+                                destroy (slot); // Allowed from within the callback.
+                        }
+
+                        return;
+                }
+        }
+
+        t->callback (t); // Can re-submit.
+
+        {
+                std::lock_guard lock{st->mutex};
+                --st->busy;
+        }
+
+        st->cVar.notify_all ();
+}
+
+} // namespace logic
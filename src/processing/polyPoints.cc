@@ -0,0 +1,148 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+module logic.processing;
+import logic.core;
+import logic.data;
+import logic.util;
+
+namespace logic {
+
+size_t toPolyPoints (BlockArray::SubRange const &range, size_t channel, SampleIdx begin, SampleNum length, float width, std::span<float> out,
+                     PolyPointsCfg const &cfg)
+{
+        ZoneScoped;
+
+        if (std::ranges::empty (range) || length.get () <= 0) {
+                return 0;
+        }
+
+        if (bitsPerSample (range) != 1) {
+                throw Exception{"toPolyPoints : only 1 bit per sample is supported."};
+        }
+
+        auto const winBegin = begin.get ();
+        auto const winEnd = winBegin + length.get ();
+        auto const scale = double (width) / double (length.get ());
+        auto const left = float (cfg.padding);
+        auto const right = left + width;
+
+        size_t written{};
+        bool full = false;
+
+        auto push = [&] (float x, bool bit) {
+                if (written + 2 > out.size ()) {
+                        full = true;
+                        return;
+                }
+
+                out[written++] = std::clamp (x, left, right);
+                out[written++] = (bit) ? (0) : (cfg.height);
+        };
+
+        bool started = false;
+        bool level{};
+        float lastX = left;
+
+        for (Block const &block : range) {
+                auto const z = int64_t (block.zoomOut ());
+                auto const bFirst = block.firstSampleNo ().get ();
+                auto const n = block.channelLength ().get ();
+                auto x = [&] (int64_t j) { return float (cfg.padding + double (bFirst + j * z - winBegin) * scale); };
+
+                // Block local sample indices overlapping the window.
+                auto lo = std::max<int64_t> ((winBegin - bFirst) / z, 0);
+                auto hi = std::min<int64_t> ((winEnd - bFirst + z - 1) / z, n);
+
+                if (lo >= hi) {
+                        continue;
+                }
+
+                std::span<uint8_t const> data = block.channel (channel);
+
+                if (!started) {
+                        level = detail::bitAt (data, lo);
+                        push (x (lo), level);
+                        started = true;
+                }
+                else if (detail::bitAt (data, lo) != level) { // Edge on the block boundary.
+                        push (x (lo), level);
+                        level = !level;
+                        push (x (lo), level);
+                }
+
+                detail::forEachEdge (data, size_t (lo), size_t (hi), [&] (size_t p) {
+                        if (full) {
+                                return;
+                        }
+
+                        auto px = x (int64_t (p));
+                        push (px, level);
+                        level = !level;
+                        push (px, level);
+                });
+
+                lastX = x (hi);
+
+                if (full) {
+                        break;
+                }
+        }
+
+        if (started) {
+                push (lastX, level);
+        }
+
+        return written;
+}
+
+/****************************************************************************/
+
+void toPolyPoints (IBackend const &backend, size_t groupIdx, std::span<PolyPointsRequest const> requests, PolyPointsCfg const &cfg, ThreadPool *pool,
+                   PolyPointsBatch *out)
+{
+        ZoneScoped;
+        auto const n = requests.size ();
+        std::vector<BlockArray::SubRange> ranges (n);
+        std::vector<size_t> bounds (n);
+        out->offsets.resize (n);
+        out->sizes.assign (n, 0);
+        size_t total{};
+
+        for (size_t i = 0; i < n; ++i) {
+                auto const &r = requests[i];
+                ranges[i] = backend.range (groupIdx, r.begin, r.length, r.zoomOut);
+
+                if (!std::ranges::empty (ranges[i])) {
+                        // `range` may have picked a finer level than requested. Worst case is 2 vertices per sample.
+                        auto levelSamples = std::max<int64_t> (r.length.get () / int64_t (std::ranges::begin (ranges[i])->zoomOut ()), 0);
+                        bounds[i] = size_t (levelSamples + 2) * 4;
+                }
+
+                out->offsets[i] = total;
+                total += bounds[i];
+        }
+
+        if (out->vertices.size () < total) {
+                out->vertices.resize (total);
+        }
+
+        pool->parallelFor (n, [&] (size_t i) {
+                auto const &r = requests[i];
+                auto slot = std::span{out->vertices}.subspan (out->offsets[i], bounds[i]);
+                out->sizes[i] = toPolyPoints (ranges[i], r.channel, r.begin, r.length, r.width, slot, cfg);
+        });
+}
+
+} // namespace logic
@@ -12,6 +12,7 @@ module;
 #include <chrono>
 #include <climits>
 #include <cstdint>
+#include <format>
 #include <span>
 #include <variant>
 #include <vector>
@@ -202,6 +203,32 @@ std::vector<Bytes> rearrange (RawData const &rd, common::acq::Params const &para
 
 /****************************************************************************/
 
+RawData encode (std::vector<Bytes> const &digital, common::acq::Params const &params)
+{
+        if (params.digitalChannels == 0 || params.digitalEncoding != common::acq::DigitalChannelEncoding::flexio) {
+                throw Exception{"Only digital flexio encoding is implemented."};
+        }
+
+        if (digital.size () != params.digitalChannels) {
+                throw Exception{std::format ("Encode: {} channels provided, but {} configured.", digital.size (), params.digitalChannels)};
+        }
+
+        switch (params.digitalChannels) {
+        case 1:
+                return encodeFlexio<1, 4> (digital);
+        case 2:
+                return encodeFlexio<2, 2> (digital);
+        case 4:
+                return encodeFlexio<4> (digital);
+        case 8:
+                return encodeFlexio<8> (digital);
+        default:
+                throw Exception{"Wrong channel number for flexio encode."};
+        }
+}
+
+/****************************************************************************/
+
 std::vector<Bytes> prepareDigitalBlocks (RawData const &rd, size_t channelsNum, bool resize)
 {
         std::vector<Bytes> digital (channelsNum);
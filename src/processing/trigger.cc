@@ -0,0 +1,211 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <utility>
+#include <vector>
+module logic.processing;
+import logic.core;
+import logic.data;
+
+namespace logic {
+
+namespace {
+        constexpr size_t WORD_BITS = ConditionEvaluator::WORD_BITS;
+        uint64_t samples (Trigger::Batch const &batch) { return batch.front ().size () * CHAR_BIT; }
+} // namespace
+
+/****************************************************************************/
+
+Trigger::Trigger (TriggerConfig config) { configure (std::move (config)); }
+
+/****************************************************************************/
+
+void Trigger::configure (TriggerConfig config)
+{
+        for (auto const &cond : config.sequence) {
+                if (cond.type == TriggerCondition::Type::pattern && cond.mask == 0) {
+                        throw Exception{"Trigger::configure : empty pattern."};
+                }
+
+                if (cond.type == TriggerCondition::Type::pulseWidth && cond.minWidth > cond.maxWidth) {
+                        throw Exception{"Trigger::configure : minWidth > maxWidth."};
+                }
+        }
+
+        config_ = std::move (config);
+        reset ();
+}
+
+/****************************************************************************/
+
+void Trigger::reset ()
+{
+        ring.clear ();
+        ringSamples = 0;
+        stage = 0;
+        lastLevels = 0;
+        haveLast = false;
+        runStart.reset ();
+        sampleNo = 0;
+        postLeft = 0;
+        position_ = 0;
+        fired_ = false;
+        done_ = false;
+}
+
+/****************************************************************************/
+
+std::optional<uint64_t> Trigger::position () const
+{
+        if (!fired_) {
+                return {};
+        }
+
+        return position_.load ();
+}
+
+/****************************************************************************/
+
+std::vector<Trigger::Batch> Trigger::process (Batch &&batch)
+{
+        ZoneScoped;
+        std::vector<Batch> out;
+
+        if (config_.sequence.empty ()) {
+                out.push_back (std::move (batch));
+                return out;
+        }
+
+        if (done_ || batch.empty () || batch.front ().empty ()) {
+                return out;
+        }
+
+        if (batch.size () > WORD_BITS) {
+                throw Exception{"Trigger::process : too many channels."};
+        }
+
+        auto const n = samples (batch);
+
+        if (fired_) {
+                postLeft -= std::min (postLeft, n);
+                done_ = (postLeft == 0);
+                out.push_back (std::move (batch));
+                return out;
+        }
+
+        ConditionEvaluator const eval{batch, (haveLast) ? (std::optional{lastLevels}) : (std::nullopt)};
+        std::optional<size_t> hit;
+
+        for (size_t from = 0; stage < config_.sequence.size (); ++stage) {
+                if (hit = scan (config_.sequence[stage], eval, from); !hit) {
+                        break;
+                }
+
+                from = *hit + 1;
+                runStart.reset (); // Pulses are measured from the previous match on.
+
+                // ... including the one starting right at the match.
+                if (stage + 1 < config_.sequence.size () && config_.sequence[stage + 1].type == TriggerCondition::Type::pulseWidth) {
+                        auto const c = config_.sequence[stage + 1].channel;
+
+                        if (c < batch.size () && eval.edgeAt (c, *hit)) {
+                                runStart = sampleNo + *hit;
+                        }
+                }
+        }
+
+        // For the edges on the batch boundary.
+        lastLevels = 0;
+
+        for (size_t c = 0; c < batch.size (); ++c) {
+                lastLevels |= uint64_t (eval.previous (c, n)) << c;
+        }
+
+        haveLast = true;
+        sampleNo += n;
+
+        auto prune = [this] (uint64_t keep) {
+                while (!ring.empty () && ringSamples - samples (ring.front ()) >= keep) {
+                        ringSamples -= samples (ring.front ());
+                        ring.pop_front ();
+                }
+        };
+
+        if (stage < config_.sequence.size ()) {
+                ringSamples += n;
+                ring.push_back (std::move (batch));
+                prune (config_.preSamples);
+                return out;
+        }
+
+        auto const t = *hit;
+        prune ((config_.preSamples > t) ? (config_.preSamples - t) : (0));
+        position_ = ringSamples + t;
+
+        auto const after = n - t - 1; // Samples after the trigger in this batch.
+        postLeft = (config_.postSamples > after) ? (config_.postSamples - after) : (0);
+
+        std::ranges::move (ring, std::back_inserter (out));
+        ring.clear ();
+        ringSamples = 0;
+        out.push_back (std::move (batch));
+
+        fired_ = true;
+        done_ = (postLeft == 0);
+        return out;
+}
+
+/****************************************************************************/
+
+std::optional<size_t> Trigger::scan (TriggerCondition const &cond, ConditionEvaluator const &eval, size_t from)
+{
+        using Type = TriggerCondition::Type;
+        auto const n = eval.size ();
+        auto const channelsNo = eval.channelsNumber ();
+
+        if ((cond.type != Type::pattern && cond.channel >= channelsNo) || (channelsNo < WORD_BITS && (cond.mask >> channelsNo) != 0)) {
+                throw Exception{"Trigger::scan : no such channel."};
+        }
+
+        for (auto w = from / WORD_BITS; w * WORD_BITS < n; ++w) {
+                auto const valid = ConditionEvaluator::valid (w, from, n);
+
+                if (cond.type != Type::pulseWidth) {
+                        if (auto hits = eval.hits (cond, w) & valid; hits != 0) {
+                                return (w * WORD_BITS) + ConditionEvaluator::pop (&hits);
+                        }
+
+                        continue;
+                }
+
+                uint64_t samples{};
+
+                for (auto changes = eval.edges (cond.channel, w, &samples) & valid; changes != 0;) {
+                        auto p = ConditionEvaluator::pop (&changes);
+                        auto abs = sampleNo + (w * WORD_BITS) + p;
+
+                        // An edge leaving `level` ends the pulse.
+                        if (ConditionEvaluator::ends (cond, samples, p) && runStart && cond.widthMatches (abs - *runStart)) {
+                                return (w * WORD_BITS) + p;
+                        }
+
+                        runStart = abs;
+                }
+        }
+
+        return {};
+}
+
+} // namespace logic
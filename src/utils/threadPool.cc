@@ -0,0 +1,130 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+module;
+#include <Tracy.hpp>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+module logic.util;
+
+namespace logic {
+
+ThreadPool::ThreadPool (size_t threadsNo)
+{
+        // The calling thread is the one more.
+        for (size_t i = 1; i < threadsNo; ++i) {
+                threads.emplace_back ([this] (std::stop_token const &stop) { loop (stop); });
+        }
+}
+
+/****************************************************************************/
+
+ThreadPool::~ThreadPool ()
+{
+        for (auto &t : threads) {
+                t.request_stop ();
+        }
+
+        cVar.notify_all ();
+        threads.clear (); // Joins.
+}
+
+/****************************************************************************/
+
+void ThreadPool::parallelFor (size_t n, std::function<void (size_t)> const &fun)
+{
+        if (n == 0) {
+                return;
+        }
+
+        std::lock_guard submitLock{submitMutex};
+        Job j;
+        j.fun = &fun;
+        j.n = n;
+
+        {
+                std::lock_guard lock{mutex};
+                job = &j;
+                ++jobNo;
+        }
+
+        cVar.notify_all ();
+        work (&j);
+
+        {
+                // Workers may still hold the pointer even if all the items are done.
+                std::unique_lock lock{mutex};
+                doneCVar.wait (lock, [this, &j] { return j.done == j.n && active == 0; });
+                job = nullptr;
+        }
+
+        if (j.error) {
+                std::rethrow_exception (j.error);
+        }
+}
+
+/****************************************************************************/
+
+void ThreadPool::work (Job *j)
+{
+        for (size_t i = j->next++; i < j->n; i = j->next++) {
+                try {
+                        (*j->fun) (i);
+                }
+                catch (...) {
+                        std::lock_guard lock{j->errorMutex};
+
+                        if (!j->error) {
+                                j->error = std::current_exception ();
+                        }
+                }
+
+                if (++j->done == j->n) {
+                        std::lock_guard lock{mutex};
+                        doneCVar.notify_all ();
+                }
+        }
+}
+
+/****************************************************************************/
+
+void ThreadPool::loop (std::stop_token const &stop)
+{
+        setThreadName ("pool");
+        uint64_t seen{};
+
+        while (true) {
+                Job *j{};
+
+                {
+                        std::unique_lock lock{mutex};
+
+                        if (!cVar.wait (lock, stop, [this, &seen] { return job != nullptr && jobNo != seen; })) {
+                                return;
+                        }
+
+                        seen = jobNo;
+                        j = job;
+                        ++active;
+                }
+
+                work (j);
+
+                {
+                        std::lock_guard lock{mutex};
+                        --active;
+                }
+
+                doneCVar.notify_all ();
+        }
+}
+
+} // namespace logic
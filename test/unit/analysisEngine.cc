@@ -0,0 +1,155 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <ranges>
+#include <stdexcept>
+
+import logic;
+import utils;
+
+using namespace logic;
+
+namespace {
+
+/**
+ * Counts ones on a channel and checks if the engine keeps its promises. No REQUIREs
+ * here, this runs on the pool threads.
+ */
+struct CountingAnalyzer : public AbstractAnalyzer {
+        static constexpr int64_t LOOKBACK = 100;
+
+        void start () override
+        {
+                ones = 0;
+                next = 0;
+                ++startsNo;
+        }
+
+        void stop () override {}
+        AugumentedData run (BlockArray const & /* bmd */) override { return {}; }
+
+        SampleIdx feed (BlockArray::SubRange const &range, SampleIdx begin, SampleNum length) override
+        {
+                contiguous &= begin.get () == next;
+                lookbackOk &= std::ranges::begin (range)->firstSampleNo ().get () <= std::max<int64_t> (begin.get () - LOOKBACK, 0);
+                next = begin.get () + length.get ();
+                fed += length.get ();
+
+                BlockBitView view{range, 1, begin, length};
+                ones += std::ranges::count (view, true);
+
+                // Pretend we're in the middle of a frame which started LOOKBACK samples ago.
+                return SampleIdx{next - LOOKBACK, begin.sampleRate ()};
+        }
+
+        int64_t ones{};
+        int64_t next{};
+        int64_t fed{};
+        int startsNo{};
+        bool contiguous = true;
+        bool lookbackOk = true;
+};
+
+struct ThrowingAnalyzer : public AbstractAnalyzer {
+        void start () override {}
+        void stop () override {}
+        AugumentedData run (BlockArray const & /* bmd */) override { return {}; }
+        SampleIdx feed (BlockArray::SubRange const & /* range */, SampleIdx /* begin */, SampleNum /* length */) override { throw std::runtime_error{"bad"}; }
+};
+
+int64_t countOnes (Backend const &backend)
+{
+        auto len = backend.channelLength (0);
+        return std::ranges::count (BlockBitView{backend.range (0, 0_SI, len), 1, 0_SI, len}, true);
+}
+
+} // namespace
+
+TEST_CASE ("Streaming", "[analysisEngine]")
+{
+        static constexpr int64_t SAMPLES = 8192;
+        Backend backend;
+        backend.addGroup ({.channelsNumber = 4, .blockSizeB = 4 * 1024});
+
+        AnalysisEngine engine{&backend, 2};
+        engine.setMaxChunk (3000); // Smaller than a block, so the chunks don't line up.
+
+        CountingAnalyzer counting;
+        ThrowingAnalyzer throwing;
+        engine.add (&counting);
+        engine.add (&throwing);
+        REQUIRE (counting.startsNo == 1);
+
+        for (int i = 0; i < 3; ++i) {
+                backend.append (0, generateDemoDeviceBlock (4, SAMPLES));
+        }
+
+        engine.sync ();
+        REQUIRE (engine.progress (&counting).processed.get () == 3 * SAMPLES);
+        REQUIRE (engine.progress (&counting).checkpoint.get () == 3 * SAMPLES - CountingAnalyzer::LOOKBACK);
+        REQUIRE (counting.ones == countOnes (backend));
+        REQUIRE (counting.contiguous);
+        REQUIRE (counting.lookbackOk);
+
+        SECTION ("only the new data is fed")
+        {
+                backend.append (0, generateDemoDeviceBlock (4, SAMPLES));
+                engine.sync ();
+                REQUIRE (counting.fed == 4 * SAMPLES);
+                REQUIRE (counting.ones == countOnes (backend));
+                REQUIRE (counting.contiguous);
+        }
+
+        SECTION ("clear restarts")
+        {
+                backend.clear ();
+                backend.append (0, generateDemoDeviceBlock (4, SAMPLES));
+                backend.flushNotifications ();
+                engine.sync ();
+                REQUIRE (counting.startsNo == 2);
+                REQUIRE (engine.progress (&counting).processed.get () == SAMPLES);
+                REQUIRE (counting.ones == countOnes (backend));
+        }
+
+        SECTION ("clear restarts even if the group gets longer than before")
+        {
+                backend.clear ();
+
+                for (int i = 0; i < 4; ++i) {
+                        backend.append (0, generateDemoDeviceBlock (4, SAMPLES));
+                }
+
+                backend.flushNotifications ();
+                engine.sync ();
+                REQUIRE (counting.startsNo == 2);
+                REQUIRE (engine.progress (&counting).processed.get () == 4 * SAMPLES);
+                REQUIRE (counting.ones == countOnes (backend));
+        }
+
+        SECTION ("a failing analyzer doesn't break the rest")
+        {
+                auto p = engine.progress (&throwing);
+                REQUIRE (p.failed);
+                REQUIRE (p.error == "bad");
+
+                engine.remove (&throwing);
+                REQUIRE_THROWS (engine.progress (&throwing));
+        }
+
+        SECTION ("restart")
+        {
+                engine.restart (&counting);
+                REQUIRE (counting.startsNo == 2);
+                engine.sync ();
+                REQUIRE (counting.ones == countOnes (backend));
+                REQUIRE (counting.contiguous);
+        }
+}
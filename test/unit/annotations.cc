@@ -0,0 +1,101 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <vector>
+
+import logic;
+
+using namespace logic;
+
+TEST_CASE ("Annotations", "[annotations]")
+{
+        AnnotationStore store;
+
+        // UART like : 10 sample wide bytes, a gap of 2.
+        for (int64_t i = 0; i < 10000; ++i) {
+                store.add (0, i * 12, i * 12 + 10, AnnotationKind::data, {uint8_t (i)});
+        }
+
+        store.add (1, 55, 55, AnnotationKind::marker);
+        store.add (1, 100, 5000, AnnotationKind::error, {1, 2, 3});
+        REQUIRE (store.size () == 10002);
+        REQUIRE (store.size (1) == 2);
+
+        SECTION ("query")
+        {
+                auto r = store.query (25, 50);
+                REQUIRE (r.size () == 3);
+                REQUIRE (r.at (0).begin == 24);
+                REQUIRE (r.at (0).index == 2);
+                REQUIRE (r.at (2).begin == 48);
+
+                r = store.query (50, 130);
+                REQUIRE (r.size () == 9); // 7 on CH0, then the marker and the long error.
+                REQUIRE (r.at (7).kind == AnnotationKind::marker);
+                REQUIRE (r.at (8).channel == 1);
+                REQUIRE (r.at (8).end == 5000);
+
+                REQUIRE (store.query (200'000, 300'000).empty ());
+        }
+
+        SECTION ("payload")
+        {
+                REQUIRE (store.payload (0, 300) == std::vector<uint8_t>{uint8_t (300)});
+                REQUIRE (store.payload (1, 0).empty ());
+                REQUIRE (store.payload (1, 1) == std::vector<uint8_t>{1, 2, 3});
+        }
+
+        SECTION ("aggregation")
+        {
+                auto r = store.query (0, 120'000, 1000);
+                size_t count{};
+
+                for (auto const &a : r) {
+                        count += a.count;
+                }
+
+                REQUIRE (count == store.size ());
+                REQUIRE (r.size () < 10); // Dense bytes got merged.
+                REQUIRE (r.front ().count == 10000);
+        }
+
+        SECTION ("order")
+        {
+                REQUIRE_THROWS (store.add (1, 99, 110, AnnotationKind::data));
+                REQUIRE_THROWS (store.add (2, 10, 9, AnnotationKind::data));
+        }
+}
+
+TEST_CASE ("Annotations long and severe", "[annotations]")
+{
+        AnnotationStore store;
+        store.add (0, 0, 1'000'000, AnnotationKind::marker); // Spans all the others.
+
+        for (int64_t i = 0; i < 10000; ++i) {
+                store.add (0, i * 12, i * 12 + 10, (i == 5000) ? (AnnotationKind::error) : (AnnotationKind::data));
+        }
+
+        SECTION ("query")
+        {
+                auto r = store.query (60'001, 60'013);
+                REQUIRE (r.size () == 3);
+                REQUIRE (r.at (0).end == 1'000'000);
+                REQUIRE (r.at (1).kind == AnnotationKind::error);
+                REQUIRE (r.at (2).begin == 60'012);
+        }
+
+        SECTION ("aggregation")
+        {
+                auto r = store.query (0, 120'000, 1000);
+                REQUIRE (r.size () == 2); // The long one and the rest.
+                REQUIRE (r.at (1).count == 10000);
+                REQUIRE (r.at (1).kind == AnnotationKind::error); // Not the first one's.
+        }
+}
@@ -224,3 +224,49 @@ TEST_CASE ("iterate the data", "[backend]")
                 rangeBegin += rangeLen;
         }
 }
+
+TEST_CASE ("observers", "[backend]")
+{
+        struct Observer : public IBackendObserver {
+                void onNewData (DataChange const &change) override { changes.push_back (change); }
+                std::vector<DataChange> changes;
+        };
+
+        Observer observer;
+        Backend backend;
+        auto const group = backend.addGroup ({.channelsNumber = 1, .maxZoomOutLevels = 2, .zoomOutPerLevel = 2, .blockSizeB = 16});
+        backend.setNotificationRate (1);
+        backend.addObserver (&observer);
+
+        for (int i = 0; i < 10; ++i) {
+                backend.append (group, {Bytes (16, 0xf0)});
+        }
+
+        backend.flushNotifications ();
+
+        // The first one may have been delivered right away, the rest waits for the next second.
+        REQUIRE (!observer.changes.empty ());
+        REQUIRE (observer.changes.size () <= 2);
+        REQUIRE (observer.changes.front ().first == SampleIdx{0, 1_Sps});
+        REQUIRE (observer.changes.back ().last == SampleIdx{10 * 128 - 1, 1_Sps});
+        REQUIRE (observer.changes.back ().levels == 2);
+
+        for (size_t i = 1; i < observer.changes.size (); ++i) {
+                REQUIRE (observer.changes.at (i).first.get () == observer.changes.at (i - 1).last.get () + 1);
+        }
+
+        observer.changes.clear ();
+        backend.clear ();
+        backend.append (group, {Bytes (16, 0xf0)});
+        backend.flushNotifications ();
+
+        REQUIRE (observer.changes.size () <= 2);
+        REQUIRE (observer.changes.front ().cleared);
+        REQUIRE (observer.changes.back ().last == SampleIdx{127, 1_Sps});
+
+        backend.removeObserver (&observer);
+        observer.changes.clear ();
+        backend.append (group, {Bytes (16, 0xf0)});
+        backend.flushNotifications ();
+        REQUIRE (observer.changes.empty ());
+}
@@ -9,6 +9,7 @@
 module;
 #include <algorithm>
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
 #include <ranges>
 #include <type_traits>
 #include <vector>
@@ -62,6 +63,68 @@ TEST_CASE ("Basic", "[bitSpan]")
 
 /****************************************************************************/
 
+TEST_CASE ("Word algorithms", "[bitSpan]")
+{
+        Bytes bytes (40);
+
+        for (size_t i = 0; i < bytes.size (); ++i) {
+                bytes.at (i) = uint8_t (i * 37 + (i >> 2));
+        }
+
+        bytes.at (10) = bytes.at (11) = bytes.at (12) = 0x00; // Long runs, so find has something to skip.
+        bytes.at (20) = bytes.at (21) = 0xff;
+
+        SECTION ("against the iterators")
+        {
+                for (size_t offset : {0U, 1U, 7U, 63U, 65U}) {
+                        for (size_t size : {0U, 1U, 9U, 64U, 130U, 250U}) {
+                                BitSpan span{bytes.data (), offset, size};
+                                auto bits = utl::vectorize (span);
+
+                                REQUIRE (span.count () == size_t (std::ranges::count (bits, true)));
+
+                                for (size_t from : {0U, 5U, 70U}) {
+                                        auto expected = [&] (auto pred) {
+                                                for (size_t i = from; i < size; ++i) {
+                                                        if (pred (i)) {
+                                                                return i;
+                                                        }
+                                                }
+
+                                                return size;
+                                        };
+
+                                        REQUIRE (span.find (true, from) == expected ([&] (size_t i) { return bits.at (i); }));
+                                        REQUIRE (span.find (false, from) == expected ([&] (size_t i) { return !bits.at (i); }));
+                                        REQUIRE (span.findEdge (from) == expected ([&] (size_t i) { return i > from && bits.at (i) != bits.at (i - 1); }));
+                                }
+
+                                std::vector<uint64_t> out (5);
+                                REQUIRE (span.copy (out) == (size + 63) / 64);
+                                REQUIRE (utl::vectorize (BitSpan{out.data (), 0U, size}) == bits);
+                        }
+                }
+        }
+
+        SECTION ("word")
+        {
+                BitSpan span{bytes.data (), 4U, 20U};
+                REQUIRE (span.word (0) == 0x0254aULL << 44); // Zero padded
+                REQUIRE (span.word (20) == 0);
+        }
+
+        SECTION ("equal")
+        {
+                std::vector<uint16_t> words = {0xf05a, 0xcce3};
+                REQUIRE (BitSpan{words.data (), 0U, 32U}.equal (BitSpan{Bytes{0xf0, 0x5a, 0xcc, 0xe3}.data (), 0U, 32U}));
+                REQUIRE (BitSpan{words.data (), 4U, 20U}.equal (BitSpan{Bytes{0x0f, 0x05, 0xac, 0xce}.data (), 8U, 20U}));
+                REQUIRE (!BitSpan{words.data (), 4U, 20U}.equal (BitSpan{Bytes{0x0f, 0x05, 0xac, 0xce}.data (), 7U, 20U}));
+                REQUIRE (!BitSpan{words.data (), 4U, 20U}.equal (BitSpan{words.data (), 4U, 19U}));
+        }
+}
+
+/****************************************************************************/
+
 TEST_CASE ("Owning Basic", "[bitSpan]")
 {
         Bytes bytes = {
@@ -275,4 +338,50 @@ TEST_CASE ("Join multiplier", "[backend]")
                 auto ch00 = r | std::views::transform ([] (Block const &b) { return b.channel (0); }) | std::views::join;
                 REQUIRE (std::ranges::equal (ch00, Bytes{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0xa, 0xb, 0xaa, 0xef, 0xdf, 0xcf}));
         }
-}
\ No newline at end of file
+}
+TEST_CASE ("Block bit view", "[bitSpan]")
+{
+        BlockArray cbs{1, 1_Sps, 1};
+        cbs.setBlockSizeB (16);
+        cbs.append (getChannelBlockData (0));
+        cbs.append (getChannelBlockData (1));
+        cbs.append (getChannelBlockData (2));
+        cbs.append (getChannelBlockData (3));
+
+        auto r = cbs.range (0_SI, 127_SI);
+        Bytes ch1 = r | std::views::transform ([] (Block const &b) { return b.channel (1); }) | std::views::join | std::ranges::to<Bytes> ();
+        auto expected = utl::vectorize (OwningBitSpan{ch1});
+
+        BlockBitView view{r, 1};
+        REQUIRE (view.size () == 128);
+        REQUIRE (std::ranges::equal (view, expected));
+
+        SECTION ("seek")
+        {
+                auto dropped = view | std::views::drop (37);
+                REQUIRE (std::ranges::equal (dropped, expected | std::views::drop (37)));
+                REQUIRE (view[100] == expected.at (100));
+                REQUIRE (*(view.begin () + 65) == expected.at (65));
+                REQUIRE (view.end () - view.begin () == 128);
+        }
+
+        SECTION ("words")
+        {
+                // CH1 : 0x1, 0x2, 0x3, 0x4 | 0x5, 0x6, 0x7, 0x8 | ...
+                REQUIRE (view.extract (0, 16) == 0x0102);
+                REQUIRE (view.extract (28, 8) == 0x40); // Crosses the block boundary
+                REQUIRE (view.wordAt (0) == 0x0102030405060708);
+                REQUIRE (view.wordsNumber () == 2);
+
+                BlockBitView tail{r, 1, 120, -1};
+                REQUIRE (tail.size () == 8);
+                REQUIRE (tail.wordAt (0) == 0x8fULL << 56); // Zero padded
+        }
+
+        SECTION ("samples")
+        {
+                BlockBitView part{r, 1, 40_SI, SampleNum (16)};
+                REQUIRE (part.size () == 16);
+                REQUIRE (part.extract (0, 16) == 0x0607);
+        }
+}
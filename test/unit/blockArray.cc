@@ -583,3 +583,62 @@ TEST_CASE ("ZoomOut", "[blockArray]")
                 }
         }
 }
+
+TEST_CASE ("Channel stats", "[blockArray]")
+{
+        static constexpr size_t CHANNEL_B = 16;
+        BlockArray cbs{2, 1000_Sps, 1};
+        cbs.setBlockSizeB (2 * CHANNEL_B);
+        cbs.setBlockSizeMultiplier (2); // Stats of the appended parts get combined.
+
+        // CH0 : 5 samples high, 5 low. CH1 : low except one sample.
+        auto bit = [] (size_t ch, int64_t i) { return (ch == 0) ? ((i / 5) % 2 == 0) : (i == 700); };
+
+        for (size_t b = 0; b < 10; ++b) {
+                std::vector<Bytes> chunk{Bytes (CHANNEL_B), Bytes (CHANNEL_B)};
+
+                for (size_t ch = 0; ch < chunk.size (); ++ch) {
+                        for (size_t i = 0; i < CHANNEL_B * CHAR_BIT; ++i) {
+                                if (bit (ch, int64_t (b * CHANNEL_B * CHAR_BIT + i))) {
+                                        chunk.at (ch).at (i / CHAR_BIT) |= uint8_t (0x80 >> (i % CHAR_BIT));
+                                }
+                        }
+                }
+
+                cbs.append (std::move (chunk));
+        }
+
+        auto const &data = BlockArrayUtHelper::data (cbs);
+        REQUIRE (data.size () == 5);
+        REQUIRE (data.front ().stats ().size () == 2);
+        REQUIRE (data.front ().stats ().at (0).edges == 51);
+        REQUIRE (data.front ().stats ().at (1).high == 0);
+
+        auto check = [&] (size_t ch, int64_t begin, int64_t end) {
+                ChannelStats expected{.samples = uint64_t (end - begin + 1), .first = bit (ch, begin), .last = bit (ch, end)};
+
+                for (auto i = begin; i <= end; ++i) {
+                        expected.high += bit (ch, i);
+                        expected.edges += (i > begin && bit (ch, i) != bit (ch, i - 1));
+                }
+
+                auto s = cbs.stats (ch, SampleIdx{begin, 1000_Sps}, SampleIdx{end, 1000_Sps});
+                REQUIRE (s.samples == expected.samples);
+                REQUIRE (s.high == expected.high);
+                REQUIRE (s.edges == expected.edges);
+                REQUIRE (s.first == expected.first);
+                REQUIRE (s.last == expected.last);
+        };
+
+        check (0, 0, 1279);
+        check (0, 3, 1271);
+        check (0, 255, 256);
+        check (0, 300, 1000);
+        check (1, 0, 1279);
+        check (1, 600, 700);
+
+        auto s = cbs.stats (0, SampleIdx{0, 1000_Sps}, SampleIdx{999, 1000_Sps});
+        REQUIRE (s.dutyCycle () == 0.5);
+        REQUIRE (s.rising () == 99); // The first one at 0 is not an edge.
+        REQUIRE (s.frequency (1000_Sps) == 99.5);
+}
@@ -8,6 +8,11 @@
 
 import logic;
 #include <catch2/catch_test_macros.hpp>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
 using namespace logic;
 
 TEST_CASE ("Valid", "[integrity]")
@@ -127,4 +132,56 @@ TEST_CASE ("Use case 1", "[integrity]")
 
         ClockSignalCheck csc; // dmaBlockLength is not important in  this case
         REQUIRE ((csc.analyzeDataIntegrity (a.data (), a.size ())) == 0);
-}
\ No newline at end of file
+}
+
+TEST_CASE ("Ordinal", "[integrity]")
+{
+        static constexpr size_t DMA_BLOCK_B = 64;
+
+        auto raw = [] (std::vector<uint32_t> const &ordinals) {
+                RawData rd;
+                rd.buffer.resize (ordinals.size () * DMA_BLOCK_B);
+
+                for (size_t i = 0; i < ordinals.size (); ++i) {
+                        std::memcpy (rd.buffer.data () + i * DMA_BLOCK_B, &ordinals.at (i), sizeof (uint32_t));
+                }
+
+                return rd;
+        };
+
+        OrdinalCheck oc{DMA_BLOCK_B};
+        oc.start ();
+        oc.runRaw (raw ({7, 8, 9, 10}));
+        oc.runRaw (raw ({11, 12}));
+        REQUIRE (oc.overrunsNo () == 0);
+        REQUIRE (oc.blocksNo () == 6);
+
+        // Jump by 3, a repeated one, a jump back and a (valid) wrap around.
+        oc.runRaw (raw ({15, 16, 16, 0xffffffff, 0}));
+        REQUIRE (oc.overrunsNo () == 5);
+}
+
+TEST_CASE ("Flexio synchronization", "[integrity]")
+{
+        RawData rd;
+
+        for (uint32_t i = 0; i < 256; ++i) {
+                std::array<uint32_t, 4> group{i * 0x01010101U, i * 0x01010101U, i * 0x01010101U, i * 0x01010101U};
+
+                if (i == 3 || i == 200) {
+                        group.at (i % 4) ^= 0x10;
+                }
+
+                rd.buffer.resize (rd.buffer.size () + sizeof (group));
+                std::memcpy (rd.buffer.data () + rd.buffer.size () - sizeof (group), group.data (), sizeof (group));
+        }
+
+        FlexioSynchronizationCheck fsc{1024};
+        fsc.start ();
+        REQUIRE (!fsc.firstError ());
+        fsc.runRaw (rd);
+        REQUIRE (fsc.errorsNo () == 2);
+        REQUIRE (fsc.firstError () == 0); // Groups 0-63 are in the first block.
+        REQUIRE (fsc.analyzeDataIntegrityBlock (std::span{rd.buffer}.first (1024)) == 1);
+        REQUIRE (fsc.analyzeDataIntegrityBlock (std::span{rd.buffer}.subspan (1024, 1024)) == 0);
+}
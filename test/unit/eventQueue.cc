@@ -7,11 +7,14 @@
  ****************************************************************************/
 
 #include <any>
+#include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <functional>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 import logic;
 using namespace logic;
 using namespace std::chrono_literals;
@@ -85,6 +88,86 @@ TEST_CASE ("Event queue threads", "[eventQueue]")
 
 /****************************************************************************/
 
+TEST_CASE ("Event queue full", "[eventQueue]")
+{
+        EventQueue events{4};
+        std::vector<std::string> names;
+        events.addCallback<ErrorEvent> ([&names] (std::string const &name) { names.push_back (name); });
+
+        for (int i = 0; i < 6; ++i) {
+                REQUIRE (events.addEvent<ErrorEvent> (std::to_string (i)) == (i < 4));
+        }
+
+        REQUIRE (events.dropped () == 2);
+        events.run ();
+        REQUIRE (names == std::vector<std::string>{"0", "1", "2", "3"});
+
+        REQUIRE (events.addEvent<ErrorEvent> ("4"s)); // Room again.
+        events.run ();
+        REQUIRE (names.size () == 5);
+}
+
+/****************************************************************************/
+
+struct ThrowingEvent : public IEvent {
+        explicit ThrowingEvent (int) { throw std::runtime_error{"ThrowingEvent"}; }
+        bool execute (std::any const & /* func */) const override { return false; }
+};
+
+/*--------------------------------------------------------------------------*/
+
+TEST_CASE ("Event constructor throws", "[eventQueue]")
+{
+        EventQueue events{2};
+        std::vector<std::string> names;
+        events.addCallback<ErrorEvent> ([&names] (std::string const &name) { names.push_back (name); });
+
+        // The slots were used before.
+        events.addEvent<ErrorEvent> ("0"s);
+        events.addEvent<ErrorEvent> ("1"s);
+        events.run ();
+
+        REQUIRE_THROWS (events.addEvent<ThrowingEvent> (0));
+        events.addEvent<ErrorEvent> ("2"s);
+        events.run ();
+        REQUIRE (names == std::vector<std::string>{"0", "1", "2"});
+}
+
+/****************************************************************************/
+
+/// Too big for the ring slot, and dispatched directly.
+class BigEvent : public IEvent {
+public:
+        explicit BigEvent (int value) : value{value} {}
+
+        bool execute (std::any const & /* func */) const override { return false; }
+
+        template <typename Call> bool dispatch (Call &call) const
+        {
+                call (value, payload.size ());
+                return true;
+        }
+
+private:
+        int value;
+        std::array<char, 4 * EventQueue::SLOT_B> payload{};
+};
+
+/*--------------------------------------------------------------------------*/
+
+TEST_CASE ("Typed dispatch", "[eventQueue]")
+{
+        EventQueue events;
+        int sum{};
+        events.addCallback<BigEvent> ([&sum] (int value, size_t size) { sum += value + int (size); });
+        events.addEvent<BigEvent> (1);
+        events.addEvent<BigEvent> (2);
+        events.run ();
+        REQUIRE (sum == 3 + 2 * 4 * int (EventQueue::SLOT_B));
+}
+
+/****************************************************************************/
+
 class TestAlarm : public AbstractAlarm<TestAlarm> {
 public:
         bool execute (std::any const &func) const override
@@ -155,3 +238,35 @@ TEST_CASE ("Alarm", "[eventQueue]")
                 REQUIRE (names == std::set<std::string>{"11", "22"});
         }
 }
+
+/****************************************************************************/
+
+TEST_CASE ("Alarm queue full", "[eventQueue]")
+{
+        EventQueue events{2};
+        std::vector<std::string> names;
+        events.addCallback<ErrorEvent> ([&names] (std::string const &name) { names.push_back (name); });
+        events.addCallback<TestConnectedAlarm::Set> ([&names] (std::string const &name) { names.push_back (name + ".set"); });
+        events.addCallback<TestConnectedAlarm::Clear> ([&names] (std::string const &name) { names.push_back (name + ".clear"); });
+
+        REQUIRE (events.addEvent<ErrorEvent> ("0"s));
+        REQUIRE (events.addEvent<ErrorEvent> ("1"s));
+
+        // The ring is full, but the alarm state changes (and the reliable events) are not lost.
+        events.setAlarm<TestConnectedAlarm> ("a"s);
+        events.clearAlarm<TestConnectedAlarm> ("a"s);
+        events.addReliableEvent<ErrorEvent> ("r"s);
+        events.setAlarm<TestConnectedAlarm> ("b"s);
+        REQUIRE (!events.addEvent<ErrorEvent> ("2"s));
+        REQUIRE (events.dropped () == 1);
+
+        events.run ();
+        REQUIRE (names == std::vector<std::string>{"0", "1", "a.set", "a.clear", "r", "b.set"});
+
+        // Room again.
+        names.clear ();
+        events.clearAlarm<TestConnectedAlarm> ("b"s);
+        events.addEvent<ErrorEvent> ("3"s);
+        events.waitForEvents ();
+        REQUIRE (names == std::vector<std::string>{"b.clear", "3"});
+}
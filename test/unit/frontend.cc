@@ -7,7 +7,10 @@
  ****************************************************************************/
 
 #include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdint>
 #include <ranges>
+#include <tuple>
 #include <vector>
 
 import logic;
@@ -27,6 +30,7 @@ TEST_CASE ("new data", "[frontend]")
         REQUIRE (frontend2.isNewData () == false);
 
         backend.append (0, generateDemoDeviceBlock ());
+        backend.flushNotifications (); // Otherwise delivered later, from the backend's thread.
 
         REQUIRE (frontend1.isNewData () == true);
         REQUIRE (frontend1.isNewData () == false);
@@ -34,6 +38,7 @@ TEST_CASE ("new data", "[frontend]")
         REQUIRE (frontend2.isNewData () == false);
 
         backend.append (0, generateDemoDeviceBlock ());
+        backend.flushNotifications (); // Otherwise delivered later, from the backend's thread.
 
         REQUIRE (frontend1.isNewData () == true);
         REQUIRE (frontend1.isNewData () == false);
@@ -110,3 +115,157 @@ TEST_CASE ("square wave integration test usecase", "[frontend]")
                 REQUIRE (expected == actual);
         }
 }
+
+TEST_CASE ("envelope", "[frontend]")
+{
+        Backend backend;
+        auto group = backend.addGroup ({.channelsNumber = 1, .blockSizeB = 16});
+        DigitalFrontend frontend{&backend};
+        Bytes all;
+
+        // Mostly idle with some bursts of edges.
+        for (int i = 0; i < 16; ++i) {
+                Bytes block (16, uint8_t ((i % 3 == 0) ? (0x00) : (0xff)));
+                block.at (size_t (i) % 16) = 0b1010'0110;
+                all.insert (all.end (), block.begin (), block.end ());
+                backend.append (group, {std::move (block)});
+        }
+
+        auto bit = [&all] (int64_t p) { return bool ((all.at (size_t (p) / 8) >> (7 - p % 8)) & 1); };
+
+        for (auto [begin, end, columns] : {std::tuple{0L, 2048L, 100UL}, std::tuple{5L, 300L, 7UL}, std::tuple{127L, 129L, 2UL}, std::tuple{0L, 10L, 20UL}}) {
+                auto env = frontend.envelope (group, 0, SampleIdx (begin), SampleIdx (end), columns);
+                REQUIRE (env.size () == columns);
+
+                std::vector<ColumnEnvelope> expected (columns);
+                auto w = end - begin;
+
+                for (auto x = begin; x < end; ++x) {
+                        auto &col = expected.at (size_t ((x - begin) * int64_t (columns) / w));
+                        col.hasHigh |= bit (x);
+                        col.hasLow |= !bit (x);
+                        col.edgesNo += uint32_t (x > begin && bit (x) != bit (x - 1));
+                }
+
+                for (auto [e, a] : std::views::zip (expected, env)) {
+                        REQUIRE (e.hasHigh == a.hasHigh);
+                        REQUIRE (e.hasLow == a.hasLow);
+                        REQUIRE (e.edgesNo == a.edgesNo);
+                }
+        }
+
+        REQUIRE (frontend.envelope (group, 0, 0_SI, 0_SI, 10).size () == 10);
+        REQUIRE (frontend.envelope (group, 0, 0_SI, 100_SI, 0).empty ());
+}
+
+TEST_CASE ("tile cache", "[frontend]")
+{
+        Backend backend;
+        auto group = backend.addGroup ({.channelsNumber = 1, .blockSizeB = 16}); // 128 samples per block
+        DigitalFrontend frontend{&backend};
+        frontend.setTileConfig ({.samplesPerTile = 256, .width = 256, .height = 10});
+
+        auto append = [&backend, group] (uint8_t v) {
+                backend.append (group, {Bytes (16, v)});
+                backend.flushNotifications ();
+        };
+
+        append (0xf0);
+        auto tail = frontend.tile (group, 0, 1, 0);
+        REQUIRE (!tail->complete);
+        REQUIRE (!tail->vertices.empty ());
+        REQUIRE (frontend.tile (group, 0, 1, 0) == tail); // Hit
+        REQUIRE (frontend.tileCacheStats ().hits == 1);
+
+        append (0x0f);
+        auto full = frontend.tile (group, 0, 1, 0); // Tail invalidated, rendered again
+        REQUIRE (full != tail);
+        REQUIRE (full->complete);
+        REQUIRE (full->vertices.size () > tail->vertices.size ());
+        REQUIRE (frontend.tileCacheStats ().misses == 2);
+
+        append (0xff);
+        REQUIRE (frontend.tile (group, 0, 1, 0) == full); // Complete tiles survive new data
+        REQUIRE (frontend.tile (group, 0, 1, 1)->vertices.size () == 4);
+
+        SECTION ("clear")
+        {
+                backend.clear ();
+                backend.flushNotifications ();
+                REQUIRE (frontend.tileCacheStats ().tilesNo == 0);
+        }
+
+        SECTION ("budget")
+        {
+                for (int i = 0; i < 6; ++i) {
+                        append (0xaa);
+                }
+
+                // Room for 2 busiest tiles, 4 tiles requested.
+                frontend.setTileConfig ({.samplesPerTile = 256, .width = 256, .height = 10});
+                frontend.tile (group, 0, 1, 3);
+                auto budget = 2 * frontend.tileCacheStats ().bytes;
+                frontend.setTileConfig ({.samplesPerTile = 256, .width = 256, .height = 10, .memoryBudgetB = budget});
+
+                for (int64_t i = 0; i < 4; ++i) {
+                        frontend.tile (group, 0, 1, i);
+                }
+
+                auto stats = frontend.tileCacheStats ();
+                REQUIRE (stats.evictions > 0);
+                REQUIRE (stats.bytes <= budget);
+        }
+}
+
+TEST_CASE ("prefetch", "[frontend]")
+{
+        using namespace std::chrono_literals;
+
+        Backend backend;
+        auto group = backend.addGroup ({.channelsNumber = 2, .blockSizeB = 32}); // 128 samples per block
+        DigitalFrontend frontend{&backend};
+        frontend.setTileConfig ({.samplesPerTile = 128, .width = 128, .height = 10});
+
+        for (int i = 0; i < 32; ++i) {
+                backend.append (group, {Bytes (16, 0xf0), Bytes (16, 0x0f)});
+        }
+
+        backend.flushNotifications ();
+        auto t0 = std::chrono::steady_clock::now (); // Frames are 10ms apart, no matter how slow the test runs.
+
+        SECTION ("tryTile")
+        {
+                REQUIRE (frontend.tryTile (group, 1, 1, 5) == nullptr);
+                frontend.waitForPrefetch ();
+                REQUIRE (frontend.tryTile (group, 1, 1, 5) != nullptr);
+        }
+
+        SECTION ("panning right")
+        {
+                for (int64_t i = 0; i <= 4; ++i) {
+                        frontend.viewport (
+                                {.groupIdx = group, .channels = {1}, .begin = SampleIdx (i * 128), .length = SampleNum (256), .time = t0 + i * 10ms});
+                }
+
+                // Visible: tiles 4 and 5. The ones ahead are prefetched.
+                frontend.waitForPrefetch ();
+                REQUIRE (frontend.tryTile (group, 1, 1, 6) != nullptr);
+                REQUIRE (frontend.tryTile (group, 1, 1, 7) != nullptr);
+                REQUIRE (frontend.tileCacheStats ().prefetched > 0);
+        }
+
+        SECTION ("zooming out")
+        {
+                for (size_t i = 0, z = 1; z <= 4; ++i, z *= 2) {
+                        frontend.viewport ({.groupIdx = group,
+                                            .channels = {1},
+                                            .begin = 0_SI,
+                                            .length = SampleNum (int64_t (z) * 256),
+                                            .zoomOut = z,
+                                            .time = t0 + i * 10ms});
+                }
+
+                frontend.waitForPrefetch ();
+                REQUIRE (frontend.tryTile (group, 1, 8, 0) != nullptr);
+        }
+}
@@ -0,0 +1,120 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+import logic;
+#include <catch2/catch_test_macros.hpp>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+using namespace logic;
+using namespace logic::i2c;
+
+TEST_CASE ("Streaming", "[i2c]")
+{
+        static constexpr size_t CHANNEL_B = 256;
+        static constexpr int HALF = 3;
+        Backend backend;
+        backend.addGroup ({.channelsNumber = 2, .sampleRate = 1'000'000_Sps, .blockSizeB = 2 * CHANNEL_B});
+
+        std::vector<bool> scl (20, true);
+        std::vector<bool> sda (20, true);
+        std::vector<uint8_t> bytes;
+
+        auto push = [&] (bool c, bool d, int n) {
+                scl.insert (scl.end (), n, c);
+                sda.insert (sda.end (), n, d);
+        };
+
+        auto bit = [&] (bool b) {
+                push (false, b, HALF);
+                push (true, b, HALF);
+                push (false, b, 1);
+        };
+
+        // Address + 2 data bytes, the last one NACKed. Every 4th transfer ends with a repeated START.
+        for (int t = 0; t < 40; ++t) {
+                if (t % 4 == 1) {
+                        push (false, true, HALF);
+                        push (true, true, HALF);
+                }
+
+                push (true, false, HALF);
+                push (false, false, HALF);
+
+                for (int k = 0; k < 3; ++k) {
+                        bytes.push_back (uint8_t (t * 11 + k * 3));
+
+                        for (int b = CHAR_BIT - 1; b >= 0; --b) {
+                                bit ((bytes.back () >> b) & 1);
+                        }
+
+                        bit (k == 2);
+                }
+
+                if (t % 4 != 0) {
+                        push (false, false, HALF);
+                        push (true, false, HALF);
+                        push (true, true, HALF + 5);
+                }
+        }
+
+        std::vector<Bytes> lines{Bytes (16 * CHANNEL_B, 0xff), Bytes (16 * CHANNEL_B, 0xff)};
+
+        for (size_t i = 0; i < scl.size (); ++i) {
+                auto mask = uint8_t (0x80 >> (i % CHAR_BIT));
+                lines.at (0).at (i / CHAR_BIT) &= (scl.at (i)) ? (0xff) : (~mask);
+                lines.at (1).at (i / CHAR_BIT) &= (sda.at (i)) ? (0xff) : (~mask);
+        }
+
+        I2cAnalyzer i2c{Config{.scl = 0, .sda = 1}};
+        AnalysisEngine engine{&backend, 1};
+        engine.setMaxChunk (77);
+        engine.add (&i2c);
+
+        for (size_t i = 0; i < lines.front ().size (); i += CHANNEL_B) {
+                backend.append (0, {Bytes (lines.at (0).begin () + i, lines.at (0).begin () + i + CHANNEL_B),
+                                    Bytes (lines.at (1).begin () + i, lines.at (1).begin () + i + CHANNEL_B)});
+                engine.sync ();
+        }
+
+        REQUIRE (!engine.progress (&i2c).failed);
+        REQUIRE (i2c.bytesNo () == bytes.size ());
+
+        auto const &store = *i2c.annotations ();
+        std::vector<uint8_t> decoded;
+        size_t addressesNo{}, nacksNo{}, startsNo{}, stopsNo{};
+
+        for (auto const &a : store.query (0, INT64_MAX)) {
+                switch (a.kind) {
+                case AnnotationKind::address:
+                        ++addressesNo;
+                        [[fallthrough]];
+                case AnnotationKind::data:
+                        decoded.push_back (store.payload (a.channel, a.index).at (0));
+                        break;
+                case AnnotationKind::nack:
+                        ++nacksNo;
+                        break;
+                case AnnotationKind::start:
+                        ++startsNo;
+                        break;
+                case AnnotationKind::stop:
+                        ++stopsNo;
+                        break;
+                default:
+                        break;
+                }
+        }
+
+        REQUIRE (decoded == bytes);
+        REQUIRE (addressesNo == 40);
+        REQUIRE (nacksNo == 40);
+        REQUIRE (startsNo == 40);
+        REQUIRE (stopsNo == 29); // The last one is pending : SCL high period hasn't ended.
+}
@@ -0,0 +1,174 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <utility>
+#include <vector>
+import logic;
+import utils;
+
+using namespace logic;
+
+namespace {
+
+/// Level (y) of the horizontal segment covering x.
+float levelAt (std::vector<float> const &p, float x)
+{
+        for (size_t i = 2; i < p.size (); i += 2) {
+                if (p.at (i - 1) == p.at (i + 1) && p.at (i - 2) <= x && x <= p.at (i)) {
+                        return p.at (i + 1);
+                }
+        }
+
+        return -1;
+}
+
+} // namespace
+
+TEST_CASE ("Edges only", "[polyPoints]")
+{
+        PolyPointsCfg cfg{.height = 10, .lineWidth = 1};
+
+        SECTION ("idle")
+        {
+                Bytes zeros (256);
+                auto p = toPolyPointsEdges<float> (zeros, 0, zeros.size () * 8, cfg);
+                REQUIRE (p == std::vector<float>{0, 10, 2048, 10});
+        }
+
+        SECTION ("simple")
+        {
+                Bytes d = {0b1111'0000};
+                auto p = toPolyPointsEdges<float> (d, 0, 8, cfg);
+                REQUIRE (p == std::vector<float>{0, 0, 4, 0, 4, 10, 8, 10});
+        }
+
+        SECTION ("continuation")
+        {
+                Bytes d = {0b1000'0000};
+                auto p = toPolyPointsEdges<float> (d, 0, 8, PolyPointsCfg{.height = 10, .lineWidth = 1, .continuation = true});
+                REQUIRE (p == std::vector<float>{0, 0, 0, 0, 0, 10, 7, 10});
+        }
+
+        SECTION ("random, unaligned")
+        {
+                std::srand (7);
+                Bytes d (100);
+
+                for (auto &b : d) {
+                        b = uint8_t (std::rand ());
+                }
+
+                for (size_t off : {0, 1, 7, 63, 64, 65, 100}) {
+                        size_t len = d.size () * 8 - off - 3;
+                        auto p = toPolyPointsEdges<float> (d, off, len, cfg);
+                        size_t edges{};
+
+                        for (size_t i = 0; i < len; ++i) {
+                                auto bitIdx = off + i;
+                                bool bit = (d.at (bitIdx / 8) >> (7 - bitIdx % 8)) & 1;
+                                REQUIRE (levelAt (p, float (i) + 0.5F) == ((bit) ? (0) : (10)));
+
+                                if (i > 0) {
+                                        auto prevIdx = bitIdx - 1;
+                                        edges += int (bit) != ((d.at (prevIdx / 8) >> (7 - prevIdx % 8)) & 1);
+                                }
+                        }
+
+                        REQUIRE (p.size () == 4 + edges * 4);
+                        REQUIRE (p.at (p.size () - 2) == float (len));
+                }
+        }
+}
+
+TEST_CASE ("SubRange to vertices", "[polyPoints]")
+{
+        static constexpr size_t CHANNELS = 4;
+        static constexpr size_t CHANNEL_B = 4;
+        static constexpr size_t BLOCKS = 8;
+
+        Backend backend;
+        auto group = backend.addGroup ({.channelsNumber = CHANNELS, .blockSizeB = CHANNELS * CHANNEL_B});
+        std::vector<Bytes> all (CHANNELS);
+        std::srand (3);
+
+        for (size_t b = 0; b < BLOCKS; ++b) {
+                std::vector<Bytes> block (CHANNELS, Bytes (CHANNEL_B));
+
+                for (size_t c = 0; c < CHANNELS; ++c) {
+                        for (auto &byte : block.at (c)) {
+                                byte = uint8_t ((c == 0) ? (0) : (std::rand ()));
+                                all.at (c).push_back (byte);
+                        }
+                }
+
+                backend.append (group, std::move (block));
+        }
+
+        PolyPointsCfg cfg{.height = 10, .lineWidth = 1, .padding = 5};
+        std::vector<float> out (4096);
+
+        for (size_t c = 0; c < CHANNELS; ++c) {
+                for (auto [begin, len] : {std::pair{0, 256}, std::pair{3, 100}, std::pair{31, 33}, std::pair{64, 190}}) {
+                        auto range = backend.range (group, SampleIdx (begin), SampleNum (len));
+                        auto n = toPolyPoints (range, c, SampleIdx (begin), SampleNum (len), float (len), out, cfg);
+
+                        auto expected = toPolyPointsEdges<float> (all.at (c), begin, len, cfg);
+                        REQUIRE (std::vector<float> (out.begin (), out.begin () + long (n)) == expected);
+                }
+        }
+
+        SECTION ("idle channel")
+        {
+                auto range = backend.range (group, 0_SI, SampleNum (256));
+                REQUIRE (toPolyPoints (range, 0, 0_SI, SampleNum (256), 256, out, cfg) == 4);
+        }
+
+        SECTION ("too small output")
+        {
+                std::vector<float> small (6);
+                auto range = backend.range (group, 0_SI, SampleNum (256));
+                REQUIRE (toPolyPoints (range, 1, 0_SI, SampleNum (256), 256, small, cfg) == 6);
+        }
+}
+
+TEST_CASE ("Batch", "[polyPoints]")
+{
+        static constexpr size_t CHANNELS = 16;
+        Backend backend;
+        auto group = backend.addGroup ({.channelsNumber = CHANNELS, .blockSizeB = CHANNELS * 1024});
+
+        for (int i = 0; i < 4; ++i) {
+                backend.append (group, generateDemoDeviceBlock (CHANNELS, 8192));
+        }
+
+        std::vector<PolyPointsRequest> requests;
+
+        for (size_t c = 0; c < CHANNELS; ++c) {
+                requests.push_back ({.channel = c, .begin = SampleIdx (int64_t (c) * 100), .length = SampleNum (20000), .width = 800});
+        }
+
+        PolyPointsCfg cfg{.height = 10};
+        ThreadPool pool{4};
+        PolyPointsBatch batch;
+        toPolyPoints (backend, group, requests, cfg, &pool, &batch);
+        REQUIRE (batch.size () == CHANNELS);
+
+        std::vector<float> single (100000);
+
+        for (size_t c = 0; c < CHANNELS; ++c) {
+                auto const &r = requests.at (c);
+                auto n = toPolyPoints (backend.range (group, r.begin, r.length), c, r.begin, r.length, r.width, single, cfg);
+                REQUIRE (n > 4);
+                REQUIRE (std::ranges::equal (batch[c], std::span{single}.first (n)));
+        }
+}
@@ -0,0 +1,89 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+import logic;
+#include <catch2/catch_test_macros.hpp>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+using namespace logic;
+using namespace logic::timing;
+
+namespace {
+
+void set (Bytes *out, size_t from, size_t to)
+{
+        for (auto i = from; i < to; ++i) {
+                out->at (i / CHAR_BIT) |= uint8_t (0x80 >> (i % CHAR_BIT));
+        }
+}
+
+/// Mostly idle : 10 pulses at 643, a glitch at 5000, a long high level with a glitch at 8500.
+Bytes encode (size_t sizeB)
+{
+        Bytes out (sizeB);
+
+        for (size_t k = 0; k < 10; ++k) {
+                set (&out, 643 + 12 * k, 648 + 12 * k);
+        }
+
+        set (&out, 5000, 5001);
+        set (&out, 8000, 8500);
+        set (&out, 8501, 9000);
+        return out;
+}
+
+} // namespace
+
+TEST_CASE ("Pulse widths", "[pulses]")
+{
+        static constexpr size_t BLOCK_B = 64;
+        static constexpr size_t BLOCKS = 32;
+        Backend backend;
+        backend.addGroup ({.channelsNumber = 1, .sampleRate = 1'000'000_Sps, .blockSizeB = BLOCK_B});
+        auto line = encode (BLOCKS * BLOCK_B);
+
+        for (size_t i = 0; i < line.size (); i += BLOCK_B) {
+                backend.append (0, {Bytes (line.begin () + i, line.begin () + i + BLOCK_B)});
+        }
+
+        PulseAnalyzer pulses{PulseConfig{.channels = {0}, .glitchWidth = 2}};
+
+        SECTION ("Streaming")
+        {
+                AnalysisEngine engine{&backend, 1};
+                engine.setMaxChunk (333);
+                engine.add (&pulses);
+                engine.sync ();
+
+                auto s = pulses.stats (0);
+                REQUIRE (s.high == Histogram{{1, 1}, {5, 10}, {499, 1}, {500, 1}});
+                REQUIRE (s.low == Histogram{{1, 1}, {7, 9}, {2999, 1}, {4244, 1}});
+                REQUIRE (s.glitchesNo == 2);
+
+                auto glitches = pulses.annotations ()->query (0, INT64_MAX);
+                REQUIRE (glitches.size () == 2);
+                REQUIRE (glitches.at (0).begin == 5000);
+                REQUIRE (glitches.at (0).end == 5001);
+                REQUIRE (pulses.annotations ()->payload (0, glitches.at (0).index).at (0) == 1);
+                REQUIRE (glitches.at (1).begin == 8500);
+                REQUIRE (pulses.annotations ()->payload (0, glitches.at (1).index).at (0) == 0);
+        }
+
+        SECTION ("Range")
+        {
+                pulses.measure (backend, 0, SampleIdx{5001, 1'000'000_Sps}, SampleIdx{8600, 1'000'000_Sps});
+
+                auto s = pulses.stats (0);
+                REQUIRE (s.high == Histogram{{500, 1}});
+                REQUIRE (s.low == Histogram{{1, 1}});
+                REQUIRE (s.glitchesNo == 1);
+                REQUIRE (pulses.annotations ()->query (0, INT64_MAX).size () == 1);
+        }
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <filesystem>
+#include <ranges>
+import logic;
+
+using namespace logic;
+
+TEST_CASE ("Write and read back", "[rawJournal]")
+{
+        auto path = std::filesystem::temp_directory_path () / "logicLinkRawJournalTest.bin";
+        std::filesystem::remove (path);
+
+        auto now = std::chrono::steady_clock::now ();
+
+        {
+                // Tiny buffer to force several writes.
+                RawJournalWriter writer{path, 16};
+                writer.append ({.bps = 1.0, .overrunsNo = 0, .buffer = Bytes{1, 2, 3}}, false, now);
+                writer.append ({.bps = 2.0, .overrunsNo = 1, .buffer = Bytes{}}, true, now);
+                writer.append ({.bps = 3.0, .overrunsNo = 2, .buffer = std::views::iota (0, 64) | std::ranges::to<Bytes> ()}, false, now);
+                REQUIRE (writer.size () == 3);
+        }
+
+        SECTION ("all entries")
+        {
+                RawJournalReader reader{path};
+                REQUIRE (reader.size () == 3);
+
+                REQUIRE (std::ranges::equal (reader.at (0).data, Bytes{1, 2, 3}));
+                REQUIRE (!reader.at (0).header->compressed ());
+                REQUIRE (reader.at (0).header->bps == 1.0);
+                REQUIRE (reader.at (0).header->timestampNs
+                         == std::chrono::duration_cast<std::chrono::nanoseconds> (now.time_since_epoch ()).count ());
+
+                REQUIRE (reader.at (1).data.empty ());
+                REQUIRE (reader.at (1).header->compressed ());
+                REQUIRE (reader.at (1).header->overrunsNo == 1);
+
+                REQUIRE (std::ranges::equal (reader.at (2).data, std::views::iota (0, 64)));
+                REQUIRE (std::ranges::distance (reader.entries ()) == 3);
+        }
+
+        SECTION ("next acquisition overwrites")
+        {
+                {
+                        RawJournalWriter writer{path};
+                        writer.append ({.bps = 4.0, .overrunsNo = 0, .buffer = Bytes{4}}, false, now);
+                }
+
+                RawJournalReader reader{path};
+                REQUIRE (reader.size () == 1);
+                REQUIRE (std::ranges::equal (reader.at (0).data, Bytes{4}));
+        }
+
+        SECTION ("torn last entry")
+        {
+                std::filesystem::resize_file (path, std::filesystem::file_size (path) - 1);
+                RawJournalReader reader{path};
+                REQUIRE (reader.size () == 2);
+        }
+
+        std::filesystem::remove (path);
+}
@@ -298,3 +298,39 @@ TEST_CASE ("flexio", "[rearrange]")
                          });
         }
 }
+
+TEST_CASE ("encode", "[rearrange]")
+{
+        auto roundTrip = [] (size_t channelsNo, size_t bytesPerChannel) {
+                std::vector<Bytes> digital;
+
+                for (size_t i = 0; i < channelsNo; ++i) {
+                        Bytes ch (bytesPerChannel);
+
+                        for (size_t j = 0; j < bytesPerChannel; ++j) {
+                                ch[j] = uint8_t (j * 7 + i * 13 + (j >> 3));
+                        }
+
+                        digital.push_back (std::move (ch));
+                }
+
+                common::acq::Params params;
+                params.digitalChannels = channelsNo;
+                params.digitalEncoding = common::acq::DigitalChannelEncoding::flexio;
+
+                RawData raw = encode (digital, params);
+                REQUIRE (raw.buffer.size () == channelsNo * bytesPerChannel);
+                REQUIRE (rearrange (raw, params) == digital);
+        };
+
+        SECTION ("1 channel 4 shifters") { roundTrip (1, 64); }
+        SECTION ("2 channels 2 shifters") { roundTrip (2, 64); }
+        SECTION ("4 channels") { roundTrip (4, 64); }
+        SECTION ("8 channels") { roundTrip (8, 64); }
+
+        SECTION ("1 channel 2 shifters")
+        {
+                std::vector<Bytes> digital{Bytes{0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07}};
+                REQUIRE (rearrangeFlexio<1, 2> (encodeFlexio<1, 2> (digital)) == digital);
+        }
+}
@@ -0,0 +1,58 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+#include "common/params.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <climits>
+#include <thread>
+import logic;
+
+using namespace logic;
+using namespace std::chrono_literals;
+
+TEST_CASE ("Synthesized replay", "[replay]")
+{
+        static constexpr auto TRANSFERS_NO = 16U;
+
+        EventQueue eventQueue;
+        Backend backend;
+        auto group = backend.addGroup ({.channelsNumber = 8, .blockSizeB = DEFAULT_USB_TRANSFER_SIZE_B});
+
+        ReplayDevice device{&eventQueue, {.transfersNo = TRANSFERS_NO}};
+        device.setGroupsIdx ({group});
+        device.start (&backend);
+
+        while (device.acquiring ()) {
+                std::this_thread::sleep_for (1ms);
+        }
+
+        device.stop ();
+
+        auto stats = device.stats ();
+        REQUIRE (stats.transfersNo == TRANSFERS_NO);
+        REQUIRE (stats.bytes == TRANSFERS_NO * DEFAULT_USB_TRANSFER_SIZE_B);
+        REQUIRE (stats.samplesPerChannel == TRANSFERS_NO * DEFAULT_USB_TRANSFER_SIZE_B / 8 * CHAR_BIT);
+        REQUIRE (backend.channelLength (group).get () == int64_t (stats.samplesPerChannel));
+        REQUIRE (stats.mbps () > 0);
+        REQUIRE (stats.msps () > 0);
+}
+
+TEST_CASE ("Replay started twice", "[replay]")
+{
+        EventQueue eventQueue;
+        Backend backend;
+        auto group = backend.addGroup ({.channelsNumber = 8, .blockSizeB = DEFAULT_USB_TRANSFER_SIZE_B});
+
+        ReplayDevice device{&eventQueue, {.transfersNo = 0}}; // Infinite, stopped by us.
+        device.setGroupsIdx ({group});
+        device.start (&backend);
+        REQUIRE_THROWS (device.start (&backend));
+        device.stop ();
+        REQUIRE (!device.acquiring ());
+}
@@ -0,0 +1,114 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+import logic;
+#include <catch2/catch_test_macros.hpp>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+using namespace logic;
+using Type = SearchCondition::Type;
+
+namespace {
+
+std::vector<int64_t> positions (std::vector<SampleIdx> const &v)
+{
+        std::vector<int64_t> ret;
+
+        for (auto const &s : v) {
+                ret.push_back (s.get ());
+        }
+
+        return ret;
+}
+
+} // namespace
+
+TEST_CASE ("Search", "[search]")
+{
+        static constexpr size_t CHANNEL_B = 64;
+        static constexpr size_t BLOCKS = 100;
+        Backend backend;
+        backend.addGroup ({.channelsNumber = 2, .sampleRate = 1'000'000_Sps, .blockSizeB = 2 * CHANNEL_B});
+
+        /*
+         * CH0 : idle low, and every 10th block a 20 sample pulse at 100 plus a 3 sample one
+         * at 300 (a glitch). CH1 : high in the blocks 50 - 59.
+         */
+        for (size_t b = 0; b < BLOCKS; ++b) {
+                std::vector<Bytes> chunk{Bytes (CHANNEL_B), Bytes (CHANNEL_B, (b >= 50 && b < 60) ? (0xff) : (0x00))};
+
+                if (b % 10 == 0) {
+                        for (size_t i = 100; i < 120; ++i) {
+                                chunk.at (0).at (i / CHAR_BIT) |= uint8_t (0x80 >> (i % CHAR_BIT));
+                        }
+
+                        chunk.at (0).at (300 / CHAR_BIT) |= 0b0000'1110;
+                }
+
+                backend.append (0, std::move (chunk));
+        }
+
+        auto const blockLen = int64_t (CHANNEL_B * CHAR_BIT);
+        auto const first = SampleIdx{0, 1'000'000_Sps};
+        auto const last = SampleIdx{int64_t (BLOCKS) * blockLen - 1, 1'000'000_Sps};
+        Searcher searcher{&backend, 4};
+
+        SECTION ("edge")
+        {
+                auto r = positions (searcher.search (0, {.type = Type::edge, .channel = 0, .edge = Edge::rising}, first, last));
+                REQUIRE (r.size () == 2 * BLOCKS / 10);
+                REQUIRE (r.at (0) == 100);
+                REQUIRE (r.at (1) == 300);
+                REQUIRE (r.at (2) == blockLen * 10 + 100);
+        }
+
+        SECTION ("edge while other channel is high")
+        {
+                auto r = positions (searcher.search (0, {.type = Type::edge, .mask = 0b10, .value = 0b10, .channel = 0, .edge = Edge::falling}, first, last));
+                REQUIRE (r == std::vector<int64_t>{blockLen * 50 + 120, blockLen * 50 + 303});
+        }
+
+        SECTION ("pattern")
+        {
+                auto r = positions (searcher.search (0, {.type = Type::pattern, .mask = 0b11, .value = 0b11}, first, last));
+                REQUIRE (r == std::vector<int64_t>{blockLen * 50 + 100, blockLen * 50 + 300});
+
+                // The pattern at the beginning of the range is not a transition.
+                r = positions (searcher.search (0, {.type = Type::pattern, .mask = 0b10, .value = 0b10}, first, last));
+                REQUIRE (r == std::vector<int64_t>{blockLen * 50});
+                REQUIRE (searcher.search (0, {.type = Type::pattern, .mask = 0b10, .value = 0b10}, SampleIdx{blockLen * 50, 1'000'000_Sps}, last).empty ());
+        }
+
+        SECTION ("pulse width")
+        {
+                // Glitches.
+                auto r = positions (searcher.search (0, {.type = Type::pulseWidth, .channel = 0, .level = true, .maxWidth = 4}, first, last));
+                REQUIRE (r.size () == BLOCKS / 10);
+                REQUIRE (r.at (1) == blockLen * 10 + 303);
+
+                // Low periods spanning many blocks.
+                r = positions (searcher.search (0, {.type = Type::pulseWidth, .channel = 0, .level = false, .minWidth = 1001}, first, last));
+                REQUIRE (r.size () == BLOCKS / 10 - 1);
+                REQUIRE (r.at (0) == blockLen * 10 + 100);
+        }
+
+        SECTION ("limit")
+        {
+                auto r = positions (searcher.search (0, {.type = Type::edge, .channel = 0, .edge = Edge::both}, SampleIdx{blockLen * 20, 1'000'000_Sps}, last, 3));
+                REQUIRE (r == std::vector<int64_t>{blockLen * 20 + 100, blockLen * 20 + 120, blockLen * 20 + 300});
+                REQUIRE (!searcher.cancelled ());
+        }
+
+        SECTION ("errors")
+        {
+                REQUIRE_THROWS (searcher.search (0, {.type = Type::edge, .channel = 2}, first, last));
+                REQUIRE_THROWS (searcher.search (0, {.type = Type::pattern}, first, last));
+        }
+}
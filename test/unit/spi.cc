@@ -0,0 +1,116 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+import logic;
+#include <catch2/catch_test_macros.hpp>
+#include <climits>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace logic;
+using namespace logic::spi;
+
+namespace {
+
+/// SCK, MOSI, MISO, CS (mode 0, MSB first), `wordsPerCs` words per transaction.
+std::vector<Bytes> encode (std::vector<std::pair<uint8_t, uint8_t>> const &words, size_t wordsPerCs, int halfPeriod, size_t sizeB)
+{
+        std::vector<std::vector<bool>> lines (4);
+
+        auto push = [&lines] (std::vector<bool> const &levels, int n) {
+                for (size_t c = 0; c < lines.size (); ++c) {
+                        lines.at (c).insert (lines.at (c).end (), n, levels.at (c));
+                }
+        };
+
+        push ({false, false, false, true}, 20);
+
+        for (size_t t = 0; t < words.size (); t += wordsPerCs) {
+                push ({false, false, false, false}, 3);
+
+                for (size_t w = t; w < t + wordsPerCs; ++w) {
+                        for (int b = CHAR_BIT - 1; b >= 0; --b) {
+                                bool mosi = (words.at (w).first >> b) & 1;
+                                bool miso = (words.at (w).second >> b) & 1;
+                                push ({false, mosi, miso, false}, halfPeriod);
+                                push ({true, mosi, miso, false}, halfPeriod);
+                        }
+                }
+
+                push ({false, false, false, false}, halfPeriod);
+                push ({false, false, false, true}, 10);
+        }
+
+        std::vector<Bytes> out{Bytes (sizeB), Bytes (sizeB), Bytes (sizeB), Bytes (sizeB, 0xff)};
+
+        for (size_t c = 0; c < lines.size (); ++c) {
+                for (size_t i = 0; i < lines.at (c).size (); ++i) {
+                        auto &byte = out.at (c).at (i / CHAR_BIT);
+                        auto mask = uint8_t (0x80 >> (i % CHAR_BIT));
+                        byte = (lines.at (c).at (i)) ? (byte | mask) : (byte & ~mask);
+                }
+        }
+
+        return out;
+}
+
+} // namespace
+
+TEST_CASE ("Streaming", "[spi]")
+{
+        static constexpr size_t CHANNEL_B = 128;
+        Backend backend;
+        backend.addGroup ({.channelsNumber = 4, .sampleRate = 1'000'000_Sps, .blockSizeB = 4 * CHANNEL_B});
+
+        std::vector<std::pair<uint8_t, uint8_t>> words;
+
+        for (int i = 0; i < 200; ++i) {
+                words.emplace_back (uint8_t (i * 7), uint8_t (255 - i));
+        }
+
+        auto lines = encode (words, 5, 3, 16 * CHANNEL_B);
+
+        SpiAnalyzer spi{Config{.sck = 0, .mosi = 1, .miso = 2, .cs = 3}};
+        AnalysisEngine engine{&backend, 1};
+        engine.setMaxChunk (100); // Words cross the chunk boundaries.
+        engine.add (&spi);
+
+        for (size_t i = 0; i < lines.front ().size (); i += CHANNEL_B) {
+                std::vector<Bytes> chunk;
+
+                for (auto const &l : lines) {
+                        chunk.emplace_back (l.begin () + i, l.begin () + i + CHANNEL_B);
+                }
+
+                backend.append (0, std::move (chunk));
+                engine.sync ();
+        }
+
+        REQUIRE (!engine.progress (&spi).failed);
+        REQUIRE (spi.wordsNo () == words.size ());
+
+        auto const &store = *spi.annotations ();
+        std::vector<std::pair<uint8_t, uint8_t>> decoded (words.size ());
+        size_t mosiNo{}, misoNo{}, startsNo{};
+
+        for (auto const &a : store.query (0, INT64_MAX)) {
+                if (a.kind == AnnotationKind::data && a.channel == 1) {
+                        decoded.at (mosiNo++).first = store.payload (a.channel, a.index).at (0);
+                }
+                else if (a.kind == AnnotationKind::data && a.channel == 2) {
+                        decoded.at (misoNo++).second = store.payload (a.channel, a.index).at (0);
+                }
+                else if (a.kind == AnnotationKind::start) {
+                        ++startsNo;
+                }
+        }
+
+        REQUIRE (decoded == words);
+        REQUIRE (startsNo == words.size () / 5);
+}
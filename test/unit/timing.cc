@@ -0,0 +1,93 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+import logic;
+#include <catch2/catch_test_macros.hpp>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+using namespace logic;
+using namespace logic::timing;
+
+namespace {
+
+/// `cycles` periods (MSB first) starting at sample 13, `periods` and `highs` used in turns.
+Bytes encode (size_t cycles, std::vector<int> const &periods, int high, size_t sizeB)
+{
+        Bytes out (sizeB);
+        size_t pos = 13;
+
+        for (size_t c = 0; c < cycles; ++c) {
+                for (int i = 0; i < high; ++i, ++pos) {
+                        out.at (pos / CHAR_BIT) |= uint8_t (0x80 >> (pos % CHAR_BIT));
+                }
+
+                pos += periods.at (c % periods.size ()) - high;
+        }
+
+        return out;
+}
+
+} // namespace
+
+TEST_CASE ("Streaming", "[timing]")
+{
+        static constexpr size_t CHANNEL_B = 64;
+        static constexpr size_t BLOCKS = 16;
+        Backend backend;
+        backend.addGroup ({.channelsNumber = 2, .sampleRate = 1'000'000_Sps, .blockSizeB = 2 * CHANNEL_B});
+
+        auto clock = encode (700, {10}, 4, BLOCKS * CHANNEL_B);
+        auto jittery = encode (700, {9, 11}, 5, BLOCKS * CHANNEL_B);
+
+        TimingAnalyzer timing{Config{.channels = {0, 1}}};
+        AnalysisEngine engine{&backend, 1};
+        engine.setMaxChunk (100); // Not a multiple of 64.
+        engine.add (&timing);
+
+        for (size_t i = 0; i < BLOCKS; ++i) {
+                auto b = i * CHANNEL_B;
+                backend.append (0, {Bytes (clock.begin () + b, clock.begin () + b + CHANNEL_B),
+                                    Bytes (jittery.begin () + b, jittery.begin () + b + CHANNEL_B)});
+                engine.sync ();
+        }
+
+        REQUIRE (!engine.progress (&timing).failed);
+
+        auto s = timing.stats (0);
+        REQUIRE (s.periodsNo == 699);
+        REQUIRE (s.period == Histogram{{10, 699}});
+        REQUIRE (s.highWidth == Histogram{{4, 700}});
+        REQUIRE (s.jitter == Histogram{{0, 698}});
+        REQUIRE (s.frequency (1'000'000_Sps) == 100'000.0);
+        REQUIRE (s.dutyCycle () == 0.4);
+
+        s = timing.stats (1);
+        REQUIRE (s.period == Histogram{{9, 350}, {11, 349}});
+        REQUIRE (s.highWidth == Histogram{{5, 700}});
+        REQUIRE (s.jitter == Histogram{{-2, 349}, {2, 349}});
+        REQUIRE (s.periodSum == 350 * 9 + 349 * 11);
+        REQUIRE (s.highSum == 699 * 5);
+}
+
+TEST_CASE ("Whole array", "[timing]")
+{
+        BlockArray samples{1, 1'000'000_Sps, 1};
+        samples.setBlockSizeB (1024);
+        samples.append ({encode (500, {8, 8, 12}, 2, 1024)}); // Periods : 8, 8, 12, 8, 8, 12...
+
+        TimingAnalyzer timing;
+        timing.run (samples);
+
+        auto s = timing.stats (0);
+        REQUIRE (s.periodsNo == 499);
+        REQUIRE (s.period == Histogram{{8, 333}, {12, 166}});
+        REQUIRE (s.jitter == Histogram{{-4, 166}, {0, 166}, {4, 166}});
+        REQUIRE (s.highSum == 499 * 2);
+}
@@ -0,0 +1,109 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+import logic;
+#include <catch2/catch_test_macros.hpp>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+using namespace logic;
+using Type = TriggerCondition::Type;
+
+namespace {
+
+/// Two channels, 64 bytes (512 samples) each, with `ch0` high in [hiBegin, hiEnd) and ch1 low.
+Trigger::Batch batch (size_t hiBegin = 0, size_t hiEnd = 0)
+{
+        Trigger::Batch b{Bytes (64), Bytes (64)};
+
+        for (auto i = hiBegin; i < hiEnd; ++i) {
+                b.at (0).at (i / CHAR_BIT) |= uint8_t (0x80 >> (i % CHAR_BIT));
+        }
+
+        return b;
+}
+
+} // namespace
+
+TEST_CASE ("Trigger", "[trigger]")
+{
+        SECTION ("pass-through")
+        {
+                Trigger t;
+                REQUIRE (t.process (batch ()).size () == 1);
+                REQUIRE (!t.fired ());
+        }
+
+        SECTION ("edge, pre and post")
+        {
+                Trigger t{{.sequence = {{.type = Type::edge, .channel = 0, .edge = Edge::rising}}, .preSamples = 700, .postSamples = 600}};
+
+                for (int i = 0; i < 10; ++i) {
+                        REQUIRE (t.process (batch ()).empty ()); // Idle is dropped.
+                }
+
+                auto out = t.process (batch (100, 200));
+                REQUIRE (out.size () == 3); // 700 - 100 samples needed from the ring, i.e. 2 batches.
+                REQUIRE (t.fired ());
+                REQUIRE (*t.position () == 2 * 512 + 100);
+                REQUIRE (!t.done ());
+
+                REQUIRE (t.process (batch ()).size () == 1); // 411 + 512 >= 600
+                REQUIRE (t.done ());
+                REQUIRE (t.process (batch ()).empty ());
+
+                t.reset ();
+                REQUIRE (!t.fired ());
+                REQUIRE (t.process (batch (0, 10)).empty ()); // High from the very beginning : no edge.
+        }
+
+        SECTION ("edge on the batch boundary")
+        {
+                Trigger t{{.sequence = {{.type = Type::edge, .edge = Edge::falling}}}};
+                REQUIRE (t.process (batch (500, 512)).empty ());
+                REQUIRE (t.process (batch ()).size () == 1);
+                REQUIRE (*t.position () == 0);
+                REQUIRE (t.done ());
+        }
+
+        SECTION ("pattern")
+        {
+                Trigger t{{.sequence = {{.type = Type::pattern, .mask = 0b11, .value = 0b01}}}};
+                REQUIRE (t.process (batch ()).empty ());
+                t.process (batch (300, 301));
+                REQUIRE (*t.position () == 300);
+        }
+
+        SECTION ("pulse width sequence")
+        {
+                TriggerCondition pulse{.type = Type::pulseWidth, .channel = 0, .level = true, .minWidth = 50, .maxWidth = 60};
+                Trigger t{{.sequence = {{.type = Type::edge}, pulse}}};
+
+                REQUIRE (t.process (batch (10, 20)).empty ());   // Too short.
+                REQUIRE (t.process (batch (100, 500)).empty ()); // Too long.
+                t.process (batch (200, 260));
+                REQUIRE (*t.position () == 260);
+        }
+
+        SECTION ("pulse starting at the previous match")
+        {
+                TriggerCondition pulse{.type = Type::pulseWidth, .channel = 0, .level = true, .minWidth = 50, .maxWidth = 60};
+                Trigger t{{.sequence = {{.type = Type::edge}, pulse}}};
+
+                REQUIRE (t.process (batch (10, 65)).size () == 1); // The rising edge is the first condition and the pulse start.
+                REQUIRE (*t.position () == 65);
+        }
+
+        SECTION ("config")
+        {
+                REQUIRE_THROWS (Trigger{{.sequence = {{.type = Type::pattern}}}});
+                Trigger t{{.sequence = {{.channel = 5}}}};
+                REQUIRE_THROWS (t.process (batch ()));
+        }
+}
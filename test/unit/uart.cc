@@ -7,9 +7,152 @@
  ****************************************************************************/
 
 import logic;
+#include <bit>
 #include <catch2/catch_test_macros.hpp>
+#include <climits>
+#include <cstdint>
+#include <variant>
+#include <vector>
 
 using namespace logic;
+using namespace logic::uart;
+
+namespace {
+
+/// Line levels (MSB first in bytes) of the `values` sent back to back with some idle in between.
+Bytes encode (std::vector<uint16_t> const &values, Config const &cfg, int samplesPerBit, size_t sizeB, std::vector<bool> const &badParity = {})
+{
+        std::vector<bool> line (37, true); // Idle before.
+
+        for (size_t v = 0; v < values.size (); ++v) {
+                std::vector<bool> bits{false};
+                int ones{};
+
+                for (int i = 0; i < cfg.dataBits; ++i) {
+                        bits.push_back ((values.at (v) >> i) & 1);
+                        ones += bits.back ();
+                }
+
+                if (cfg.parity != Parity::none) {
+                        bool p = (cfg.parity == Parity::even) ? (ones % 2 != 0) : (ones % 2 == 0);
+                        bits.push_back (p != (v < badParity.size () && badParity.at (v)));
+                }
+
+                bits.push_back (true); // Stop
+
+                for (bool b : bits) {
+                        line.insert (line.end (), samplesPerBit, b);
+                }
+
+                line.insert (line.end (), v % 7, true); // Some idle.
+        }
+
+        Bytes out (sizeB, (cfg.inverted) ? (0x00) : (0xff));
+
+        for (size_t i = 0; i < line.size (); ++i) {
+                if (!line.at (i)) { // Space level is the opposite of the idle one.
+                        out.at (i / CHAR_BIT) ^= uint8_t (0x80 >> (i % CHAR_BIT));
+                }
+        }
+
+        return out;
+}
+
+std::vector<uint16_t> decoded (UartAnalyzer const &a, size_t channel = 0)
+{
+        std::vector<uint16_t> ret;
+        auto const &store = *a.annotations ();
+
+        for (auto const &ann : store.query (0, INT64_MAX)) {
+                if (ann.kind == AnnotationKind::data) {
+                        auto p = store.payload (ann.channel, ann.index);
+                        ret.push_back ((p.size () == 2) ? (p.at (0) | (p.at (1) << CHAR_BIT)) : (p.at (0)));
+                }
+        }
+
+        return ret;
+}
+
+} // namespace
+
+TEST_CASE ("Streaming", "[uart]")
+{
+        static constexpr size_t BLOCK_B = 512;
+        Backend backend;
+        backend.addGroup ({.channelsNumber = 1, .sampleRate = 1'000'000_Sps, .blockSizeB = BLOCK_B});
+
+        std::vector<uint16_t> values;
+
+        for (int i = 0; i < 300; ++i) {
+                values.push_back (uint16_t ((i * 37) & 0xff));
+        }
+
+        SECTION ("8N1 in many chunks")
+        {
+                Config cfg{.baudRate = 100'000};
+                auto line = encode (values, cfg, 10, 8 * BLOCK_B);
+
+                UartAnalyzer uart{cfg};
+                AnalysisEngine engine{&backend, 1};
+                engine.setMaxChunk (333); // Frames cross the chunk boundaries.
+                engine.add (&uart);
+
+                for (size_t i = 0; i < line.size (); i += BLOCK_B) {
+                        backend.append (0, {Bytes (line.begin () + i, line.begin () + i + BLOCK_B)});
+                        engine.sync ();
+                }
+
+                REQUIRE (decoded (uart) == values);
+                REQUIRE (uart.errorsNo () == 0);
+                REQUIRE (!engine.progress (&uart).failed);
+        }
+
+        SECTION ("9 bits, even parity, inverted, errors")
+        {
+                Config cfg{.baudRate = 125'000, .dataBits = 9, .parity = Parity::even, .inverted = true};
+
+                for (auto &v : values) {
+                        v |= (v & 1) << 8;
+                }
+
+                auto line = encode (values, cfg, 8, 8 * BLOCK_B, {false, false, true});
+
+                for (size_t i = 0; i < line.size (); i += BLOCK_B) {
+                        backend.append (0, {Bytes (line.begin () + i, line.begin () + i + BLOCK_B)});
+                }
+
+                UartAnalyzer uart{cfg};
+                AnalysisEngine engine{&backend, 1};
+                engine.add (&uart);
+                engine.sync ();
+
+                REQUIRE (decoded (uart) == values);
+                REQUIRE (uart.errorsNo () == 1);
+
+                auto errors = uart.annotations ()->query (0, INT64_MAX);
+                std::erase_if (errors, [] (auto const &a) { return a.kind != AnnotationKind::error; });
+                REQUIRE (errors.size () == 1);
+                REQUIRE (uart.annotations ()->payload (0, errors.front ().index).at (0) == uint8_t (Error::parity));
+        }
+}
+
+TEST_CASE ("Whole array, 9 bits", "[uart]")
+{
+        static constexpr size_t BLOCK_B = 512;
+        Config cfg{.baudRate = 100'000, .dataBits = 9};
+        std::vector<uint16_t> values{0x000, 0x1ff, 0x100, 0x0a5, 0x15a};
+
+        BlockArray samples{1, 1'000'000_Sps, 1};
+        samples.setBlockSizeB (BLOCK_B);
+        samples.append ({encode (values, cfg, 10, BLOCK_B)});
+
+        UartAnalyzer uart{cfg};
+        auto out = uart.run (samples);
+
+        REQUIRE (std::holds_alternative<Words> (out.data));
+        REQUIRE (std::get<Words> (out.data) == Words (values.begin (), values.end ())); // The 9th bit is there.
+        REQUIRE (uart.errorsNo () == 0);
+}
 
 #if 0
 
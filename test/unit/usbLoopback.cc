@@ -0,0 +1,127 @@
+/****************************************************************************
+ *                                                                          *
+ *  Author : lukasz.iwaszkiewicz@gmail.com                                  *
+ *  ~~~~~~~~                                                                *
+ *  License : see COPYING file for details.                                 *
+ *  ~~~~~~~~~                                                               *
+ ****************************************************************************/
+
+#include "common/params.hh"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <climits>
+#include <memory>
+#include <span>
+#include <thread>
+import logic;
+
+using namespace logic;
+using namespace std::chrono_literals;
+
+TEST_CASE ("Loopback acquisition", "[usbLoopback]")
+{
+        static constexpr auto TRANSFERS_NO = 32U;
+
+        EventQueue eventQueue;
+        Backend backend;
+        auto group = backend.addGroup ({.channelsNumber = 8, .blockSizeB = DEFAULT_USB_TRANSFER_SIZE_B});
+
+        SECTION ("throughput")
+        {
+                LoopbackParams lp{.latency = 100us, .jitter = 50us, .generator = [] (std::span<uint8_t> b) { std::ranges::fill (b, 0xaa); }};
+                LoopbackDevice device{&eventQueue, std::make_unique<LoopbackTransport> (lp)};
+
+                auto ap = device.readAcquisitionParams ();
+                ap.digitalSamplesPerChannelLimit = TRANSFERS_NO * DEFAULT_USB_TRANSFER_SIZE_B / 8 * CHAR_BIT;
+                device.writeAcquisitionParams (ap);
+                device.setGroupsIdx ({group});
+                device.start (&backend);
+
+                while (device.acquiring ()) {
+                        device.run ();
+                }
+
+                REQUIRE (backend.channelLength (group).get () >= int64_t (ap.digitalSamplesPerChannelLimit));
+
+                auto stats = device.loopback ().stats ();
+                REQUIRE (stats.errors == 0);
+                REQUIRE (stats.completed >= TRANSFERS_NO);
+                REQUIRE (stats.resubmits > 0);
+                REQUIRE (stats.callbackMax > 0ns);
+
+                auto t = device.getTelemetry ();
+                REQUIRE (t.transfersNo >= TRANSFERS_NO);
+                REQUIRE (t.rollingBps > 0);
+                REQUIRE (t.callbackToQueue.count > 0);
+                REQUIRE (t.queueToRearrange.count > 0);
+                REQUIRE (t.rearrangeToAppend.count == t.queueToRearrange.count);
+        }
+
+        SECTION ("error injection")
+        {
+                LoopbackParams lp{.errorProbability = 1.0};
+                LoopbackDevice device{&eventQueue, std::make_unique<LoopbackTransport> (lp)};
+                device.setGroupsIdx ({group});
+                device.start (&backend);
+
+                while (device.acquiring ()) {
+                        std::this_thread::sleep_for (1ms);
+                }
+
+                REQUIRE (device.health () == IDevice::Health::error);
+                REQUIRE (device.loopback ().stats ().errors > 0);
+        }
+
+        SECTION ("short transfers")
+        {
+                LoopbackParams lp{.shortTransferProbability = 1.0};
+                LoopbackDevice device{&eventQueue, std::make_unique<LoopbackTransport> (lp)};
+                device.setGroupsIdx ({group});
+                device.start (&backend);
+
+                while (device.acquiring ()) {
+                        std::this_thread::sleep_for (1ms);
+                }
+
+                REQUIRE (device.health () == IDevice::Health::error);
+                REQUIRE (device.loopback ().stats ().shortTransfers > 0);
+        }
+
+        SECTION ("stop cancels the transfers in flight")
+        {
+                LoopbackParams lp{.latency = 1h}; // Would never complete on their own.
+                LoopbackDevice device{&eventQueue, std::make_unique<LoopbackTransport> (lp)};
+                device.setGroupsIdx ({group});
+                device.start (&backend);
+                device.stop ();
+
+                for (int i = 0; i < 1000 && device.acquiring (); ++i) {
+                        std::this_thread::sleep_for (1ms);
+                }
+
+                REQUIRE (!device.acquiring ());
+                REQUIRE (device.health () == IDevice::Health::ok);
+                REQUIRE (device.loopback ().stats ().cancelled > 0);
+                REQUIRE (device.loopback ().stats ().errors == 0);
+        }
+}
+
+TEST_CASE ("Latency histogram", "[usbLoopback]")
+{
+        LatencyHistogram h;
+        REQUIRE (h.percentile (0.5) == 0ns);
+
+        for (int i = 0; i < 99; ++i) {
+                h.add (1us);
+        }
+
+        h.add (1ms);
+
+        REQUIRE (h.count == 100);
+        REQUIRE (h.min == 1us);
+        REQUIRE (h.max == 1ms);
+        REQUIRE (h.percentile (0.5) >= 1us);
+        REQUIRE (h.percentile (0.5) < 2us);
+        REQUIRE (h.percentile (1.0) == 1ms);
+}